@@ -144,6 +144,14 @@ find_package (fftw REQUIRED)
 endmacro(add_fftw3)
 
 
+# LAPACK (any implementation, e.g. reference, OpenBLAS or MKL)
+macro(add_lapack)
+find_package (LAPACK REQUIRED)
+    message(STATUS "LAPACK libs: " ${LAPACK_LIBRARIES} )
+    target_link_libraries(${PROJECT_NAME} PUBLIC ${LAPACK_LIBRARIES})
+endmacro(add_lapack)
+
+
 # boost
 macro(add_boost) # usage: add_boost(component1 component2...)
   find_package (Boost 1.54.0 COMPONENTS ${ARGV} REQUIRED)
@@ -7,13 +7,16 @@
 #pragma once
 
 #include <boost/mpi.hpp>
+#include <boost/serialization/vector.hpp>
 #include <stack>
+#include <deque>
 #include <vector>
 #include <map>
 
 namespace pMPI {
 
 enum WorkerTag { Pending, Work, Finish }; // tags for MPI communication
+enum StealTag { StealRequest = Finish + 1, StealReply, Done }; // tags for MPI communication of MPIStealingWorker
 typedef int JobId;
 typedef int WorkerId;
 
@@ -67,6 +70,55 @@ struct MPIMaster
     void fill_stack_();
 };
 
+/** A worker of a decentralized schedule without a master. Every process starts with its own chunk of jobs
+ * and, once it runs out of them, steals the cheaper half of the remaining jobs of another process.
+ * Requests from other processes are served between the jobs, so no process is spinning while the others work.
+ * Hence a thief waits for the reply at most as long as the current job of its victim takes.
+ * A process out of jobs polls for messages with an interval growing from min_wait_us() to max_wait_us()
+ * and sleeps in between, which adds up to max_wait_us() to the latency of a reply.
+ */
+struct MPIStealingWorker
+{
+    boost::mpi::communicator Comm;
+    const WorkerId id;
+
+    /** Jobs waiting for this process, the most expensive first */
+    std::deque<JobId> JobQueue;
+    /** Jobs done by this process */
+    std::vector<JobId> DoneJobs;
+
+    /** Constructor
+     * \param[in] comm Communicator of all processes taking part in the calculation
+     * \param[in] task_numbers Jobs ordered by decreasing complexity. Must be the same on all processes.
+     */
+    MPIStealingWorker(const boost::mpi::communicator &comm, const std::vector<JobId>& task_numbers);
+
+    /** Takes the next job for this process. Returns false once all processes are out of jobs. */
+    bool next_job();
+    void report_job_done();
+    /** Collects the information, which process has done which job. Must be called on all processes. */
+    std::map<JobId, WorkerId> dispatch_map() const;
+
+    JobId current_job() { return current_job_; };
+
+protected:
+    JobId current_job_;
+    /** Process to ask for jobs first */
+    WorkerId victim_;
+    /** Number of other processes, which are out of jobs */
+    int NDone;
+
+    /** Minimal and maximal interval of polling for messages while idle, in microseconds */
+    static long min_wait_us() { return 20; }
+    static long max_wait_us() { return 2000; }
+
+    /** Serves the pending requests and returns true if there were any */
+    bool serve_requests_();
+    /** Serves the pending requests, or sleeps for wait_us and increases it if there were none */
+    void idle_wait_(long& wait_us);
+    bool steal_();
+};
+
 } // end of namespace MPI
 
 
@@ -1,5 +1,5 @@
 /** \file include/mpi_dispatcher/mpi_skel.hpp
-** \brief Declares mpi_skel - a structure to simplify master-slave calculations
+** \brief Declares mpi_skel - a structure to simplify distributed calculations of independent parts
 */
 
 #ifndef __INCLUDE_MPISKEL_H
@@ -7,8 +7,9 @@
 
 #include <boost/mpi.hpp>
 #include <boost/local_function.hpp>
-#include <boost/scoped_ptr.hpp>
 #include <boost/serialization/vector.hpp>
+#include <algorithm>
+#include <vector>
 
 //#include <type_traits>
 #include "mpi_dispatcher.hpp"
@@ -18,8 +19,8 @@ namespace pMPI {
 template <typename PartType>
 struct ComputeWrap {
     PartType *x;
-    int complexity;
-    ComputeWrap(PartType &y, int complexity = 1):x(&y),complexity(complexity){};
+    double complexity;
+    ComputeWrap(PartType &y, double complexity = 1):x(&y),complexity(complexity){};
     void run(){x->compute();}; 
     ComputeWrap(){};
 };
@@ -27,20 +28,61 @@ struct ComputeWrap {
 template <typename PartType>
 struct PrepareWrap {
     PartType *x;
-    int complexity;
-    PrepareWrap(PartType &y, int complexity = 1):x(&y),complexity(complexity){};
+    double complexity;
+    PrepareWrap(PartType &y, double complexity = 1):x(&y),complexity(complexity){};
     void run(){x->prepare();}; 
     PrepareWrap(){};
 };
 
 
+// Orders parts by decreasing complexity
+struct CompareComplexity
+{
+    const std::vector<double>& complexity;
+    CompareComplexity(const std::vector<double>& complexity) : complexity(complexity) {};
+    bool operator()(size_t l, size_t r) const { return complexity[l] > complexity[r]; };
+};
+
+/** Groups parts into jobs of comparable cost. The parts are ordered by decreasing complexity. A part costing at least
+ * (total complexity) / (jobs_per_process * comm_size) is a job of its own, the cheaper ones are bundled into common
+ * jobs of about this cost.
+ * \param[in] complexity Estimated costs of the parts
+ * \param[in] comm_size Number of processes
+ * \param[in] jobs_per_process Wanted number of jobs per process
+ * \return Lists of the parts of every job, the most expensive jobs first
+ */
+inline std::vector<std::vector<size_t> > group_jobs(const std::vector<double>& complexity, int comm_size, int jobs_per_process = 4)
+{
+    std::vector<size_t> order(complexity.size());
+    double total_complexity = 0;
+    for (size_t i=0; i<complexity.size(); i++) { order[i] = i; total_complexity += complexity[i]; };
+    std::stable_sort(order.begin(), order.end(), CompareComplexity(complexity));
+    double bundle_complexity = total_complexity / (jobs_per_process * comm_size);
+
+    std::vector<std::vector<size_t> > jobs;
+    std::vector<size_t> bundle;
+    double current_complexity = 0;
+    for (size_t i=0; i<order.size(); i++) {
+        size_t p = order[i];
+        if (complexity[p] >= bundle_complexity) { jobs.push_back(std::vector<size_t>(1, p)); continue; };
+        bundle.push_back(p);
+        current_complexity += complexity[p];
+        if (current_complexity >= bundle_complexity || i + 1 == order.size()) {
+            jobs.push_back(bundle);
+            bundle.clear();
+            current_complexity = 0;
+            };
+        };
+    return jobs;
+}
+
 template <typename WrapType>
 struct mpi_skel {
     std::vector<WrapType> parts;
     std::map<pMPI::JobId, pMPI::WorkerId> run(const boost::mpi::communicator& comm, bool VerboseOutput = true);
 };
 
-/// Master-slave task schedule, associates jobs with workers and executes mpi_dispatcher to run the simulation
+/// Decentralized task schedule, runs the jobs with MPIStealingWorker and returns the information which process has done which job
 template <typename WrapType>
 std::map<pMPI::JobId, pMPI::WorkerId> mpi_skel<WrapType>::run(const boost::mpi::communicator& comm, bool VerboseOutput)
 {
@@ -49,63 +91,26 @@ std::map<pMPI::JobId, pMPI::WorkerId> mpi_skel<WrapType>::run(const boost::mpi::
     comm.barrier();
     if (rank==0) { std::cout << "Calculating " << parts.size() << " jobs using " << comm_size << " procs." << std::endl; };
 
-    size_t ROOT = 0;
-    boost::scoped_ptr<pMPI::MPIMaster> disp;
-
-    if (comm.rank() == ROOT) { 
-        // prepare one Master on a root process for distributing parts.size() jobs
-        std::vector<pMPI::JobId> job_order(parts.size());
-        for (size_t i=0; i<job_order.size(); i++) job_order[i] = i;
-        int BOOST_LOCAL_FUNCTION_TPL(bind this_, std::size_t l, std::size_t r) {
-            return (this_->parts[l].complexity > this_->parts[r].complexity); } BOOST_LOCAL_FUNCTION_NAME_TPL(comp1) 
-        std::sort(job_order.begin(), job_order.end(), comp1);
-        disp.reset(new pMPI::MPIMaster(comm,job_order,true));
-    };
-
-    comm.barrier();
+    // every process orders the jobs in the same way - the most complex ones first
+    std::vector<pMPI::JobId> job_order(parts.size());
+    for (size_t i=0; i<job_order.size(); i++) job_order[i] = i;
+    int BOOST_LOCAL_FUNCTION_TPL(bind this_, std::size_t l, std::size_t r) {
+        return (this_->parts[l].complexity > this_->parts[r].complexity); } BOOST_LOCAL_FUNCTION_NAME_TPL(comp1) 
+    std::stable_sort(job_order.begin(), job_order.end(), comp1);
 
     // Start calculating data
-    for (pMPI::MPIWorker worker(comm,ROOT);!worker.is_finished();) {
-        if (rank == ROOT) disp->order(); 
-        worker.receive_order(); 
-        if (worker.is_working()) { // for a specific worker
-            JobId p = worker.current_job();
-            if (VerboseOutput) std::cout << "["<<p+1<<"/"<<parts.size()<< "] P" << comm.rank() 
-                                         << " : part " << p << " [" << parts[p].complexity << "] run;" << std::endl;
-            parts[p].run(); 
-            worker.report_job_done(); 
-        };
-        if (rank == ROOT) disp->check_workers(); // check if there are free workers 
+    pMPI::MPIStealingWorker worker(comm, job_order);
+    while (worker.next_job()) {
+        JobId p = worker.current_job();
+        if (VerboseOutput) std::cout << "["<<p+1<<"/"<<parts.size()<< "] P" << comm.rank() 
+                                     << " : part " << p << " [" << parts[p].complexity << "] run;" << std::endl;
+        parts[p].run(); 
+        worker.report_job_done(); 
     };
-    // at this moment all communication is finished
-    //comm.barrier();
-    MPI_Barrier(MPI_COMM_WORLD);
+    // at this moment all jobs are done
+	if (VerboseOutput && rank==0) std::cout << "done." << std::endl;
     // Now spread the information, who did what.
-	if (VerboseOutput && rank==ROOT) std::cout << "done." << std::endl;
-    comm.barrier();
-    std::map<pMPI::JobId, pMPI::WorkerId> job_map;
-    if (rank == ROOT) { 
-        job_map = disp -> DispatchMap; 
-        std::vector<pMPI::JobId> jobs(job_map.size());
-        std::vector<pMPI::WorkerId> workers(job_map.size());
-
-        std::map<pMPI::JobId, pMPI::WorkerId>::const_iterator it = job_map.begin(); 
-        for (int i=0; i<workers.size(); i++) { 
-            jobs[i] = it->first;
-            workers[i] = it->second; 
-            ++it;
-        }
-        boost::mpi::broadcast(comm, jobs, ROOT);
-        boost::mpi::broadcast(comm, workers, ROOT);
-    } 
-    else {
-        std::vector<pMPI::JobId> jobs(parts.size());
-        boost::mpi::broadcast(comm, jobs, ROOT);
-        std::vector<pMPI::WorkerId> workers(parts.size());
-        boost::mpi::broadcast(comm, workers, ROOT);
-        for (size_t i=0; i<jobs.size(); i++) job_map[jobs[i]] = workers[i]; 
-    }
-    return job_map;
+    return worker.dispatch_map();
 }
 
 }; // end of namespace MPI
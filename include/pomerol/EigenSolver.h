@@ -0,0 +1,22 @@
+/** \file include/pomerol/EigenSolver.h
+** \brief Full diagonalization of dense hermitian matrices with the backend chosen at configure time.
+*/
+#ifndef __INCLUDE_EIGENSOLVER_H
+#define __INCLUDE_EIGENSOLVER_H
+
+#include "Misc.h"
+
+namespace Pomerol{
+
+/** Returns the name of the eigensolver backend: "Eigen" (Eigen::SelfAdjointEigenSolver, the default) or
+ * "LAPACK" (divide-and-conquer dsyevd/zheevd, enabled with POMEROL_USE_LAPACK). */
+const char* getEigenSolverName();
+
+/** Computes all eigenvalues and eigenvectors of a hermitian matrix.
+ * \param[in,out] H The matrix, which is replaced with the eigenvectors stored in its columns.
+ * \param[out] Eigenvalues The eigenvalues in ascending order.
+ */
+void diagonalize(MatrixType& H, RealVectorType& Eigenvalues);
+
+} // end of namespace Pomerol
+#endif // endif :: #ifndef __INCLUDE_EIGENSOLVER_H
@@ -45,7 +45,7 @@ public:
         const Hamiltonian &H, bool use_transpose = false);
 
     void prepareAll(std::set<ParticleIndex> in = std::set<ParticleIndex>());
-    void computeAll();
+    void computeAll(const boost::mpi::communicator& comm = boost::mpi::communicator());
 
     /** Returns the CreationOperator for a given Index. Makes on-demand computation. */
     const CreationOperator& getCreationOperator(ParticleIndex in) const;
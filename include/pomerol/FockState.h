@@ -0,0 +1,102 @@
+/** \file include/pomerol/FockState.h
+** \brief Declaration of FixedFockState - a Fock state stored in a single machine word.
+*/
+#ifndef __INCLUDE_FOCKSTATE_H
+#define __INCLUDE_FOCKSTATE_H
+
+#include<ostream>
+#include<stdexcept>
+#include<boost/cstdint.hpp>
+#include<boost/dynamic_bitset.hpp>
+
+namespace Pomerol{
+
+/** A Fock state of up to 64 modes stored in a 64-bit integer. It provides the part of the interface of
+ * boost::dynamic_bitset<> used for Fock states, without heap allocations. Occupation numbers are counted
+ * with a popcount. A default constructed state has size 0 and is used as an error state.
+ */
+class FixedFockState {
+public:
+    typedef boost::uint64_t block_type;
+    /** Maximal number of modes. */
+    static const size_t MaxSize = 64;
+
+    /** A proxy to a single mode, returned by the non-const operator[]. */
+    class reference {
+        FixedFockState& State;
+        size_t Pos;
+    public:
+        reference(FixedFockState& State, size_t Pos) : State(State), Pos(Pos) {};
+        operator bool() const { return State.test(Pos); };
+        reference& operator=(bool val) { State.set(Pos, val); return *this; };
+        reference& operator=(const reference& rhs) { State.set(Pos, bool(rhs)); return *this; };
+    };
+
+    FixedFockState() : Bits(0), Size(0) {};
+    /** Constructor.
+     * \param[in] size Number of modes.
+     * \param[in] value Occupation numbers of the modes as bits of an integer.
+     */
+    FixedFockState(size_t size, unsigned long value = 0) : Bits(value), Size(size)
+    {
+        if (size > MaxSize) throw std::length_error("FixedFockState : too many modes, configure with POMEROL_FIXED_FOCKSTATE=OFF");
+        if (size < MaxSize) Bits &= (block_type(1) << size) - 1;
+    };
+
+    size_t size() const { return Size; };
+    bool test(size_t pos) const { return (Bits >> pos) & 1; };
+    bool operator[](size_t pos) const { return test(pos); };
+    reference operator[](size_t pos) { return reference(*this, pos); };
+    FixedFockState& set(size_t pos, bool val = true)
+    {
+        if (val) Bits |= block_type(1) << pos; else Bits &= ~(block_type(1) << pos);
+        return *this;
+    };
+    FixedFockState& reset(size_t pos) { return set(pos, false); };
+    FixedFockState& flip(size_t pos) { Bits ^= block_type(1) << pos; return *this; };
+
+    /** Returns the number of occupied modes. */
+    size_t count() const { return popcount(Bits); };
+    /** Returns the number of occupied modes with indices below pos. */
+    size_t count_below(size_t pos) const { return popcount(Bits & ((block_type(1) << pos) - 1)); };
+    unsigned long to_ulong() const { return Bits; };
+    block_type bits() const { return Bits; };
+
+    bool operator==(const FixedFockState& rhs) const { return Size == rhs.Size && Bits == rhs.Bits; };
+    bool operator!=(const FixedFockState& rhs) const { return !(*this == rhs); };
+    bool operator<(const FixedFockState& rhs) const { return Size != rhs.Size ? Size < rhs.Size : Bits < rhs.Bits; };
+
+    /** Prints the occupation numbers, the last mode first (as boost::dynamic_bitset<> does). */
+    friend std::ostream& operator<<(std::ostream& os, const FixedFockState& s)
+    {
+        for (size_t i = s.Size; i > 0; --i) os << (s.test(i-1) ? '1' : '0');
+        return os;
+    };
+
+    static size_t popcount(block_type x)
+    {
+    #if defined(__GNUC__) || defined(__clang__)
+        return __builtin_popcountll(x);
+    #else
+        size_t n = 0;
+        for (; x; x &= x - 1) ++n;
+        return n;
+    #endif
+    };
+
+protected:
+    block_type Bits;
+    unsigned short Size;
+};
+
+/** Returns the number of occupied modes of a state with indices below pos. */
+inline size_t count_below(const FixedFockState& s, size_t pos) { return s.count_below(pos); }
+inline size_t count_below(const boost::dynamic_bitset<>& s, size_t pos)
+{
+    size_t n = 0;
+    for (size_t j = 0; j < pos; ++j) n += s[j];
+    return n;
+}
+
+} // end of namespace Pomerol
+#endif // endif :: #ifndef __INCLUDE_FOCKSTATE_H
@@ -27,8 +27,19 @@ public:
                 const Hamiltonian &H, const DensityMatrix &DM, const FieldOperatorContainer& Operators);
 
 
+    /** Sets the index permutations, which leave the Hamiltonian invariant, e.g. Symmetrizer::getPermutations().
+     * The components (i,j) and (P(i),P(j)) are then equal, and prepareAll() makes them share one
+     * GreensFunction object, which is computed only once.
+     * \param[in] Permutations Permutations of indices, index i is mapped to Permutations[n].getIndex(i).
+     */
+    void setPermutations(const std::vector<DynamicIndexCombination>& Permutations);
+
     void prepareAll(const std::set<IndexCombination2>& InitialIndices = std::set<IndexCombination2>());
-    void computeAll();
+    /** Computes all Green's functions. The components are distributed among the processes of comm,
+     * the parts of each component are computed by OpenMP threads, and the results are gathered on all processes.
+     * \param[in] comm MPI communicator.
+     */
+    void computeAll(const boost::mpi::communicator& comm = boost::mpi::communicator());
 
 protected:
 
@@ -40,6 +51,11 @@ protected:
     const Hamiltonian &H;
     const DensityMatrix &DM;
     const FieldOperatorContainer &Operators;
+
+    /** Index permutations relating the components. */
+    std::vector<DynamicIndexCombination> Permutations;
+    /** Makes the equivalent components share one element. */
+    void mergeEquivalentElements();
 };
 
 } // end of namespace Pomerol
@@ -33,6 +33,8 @@ namespace Pomerol{
  */
 class GreensFunction : public Thermal, public ComputableObject {
 
+    friend class GFContainer;
+
     /** A reference to a states classification object. */
     const StatesClassification& S;
     /** A reference to a Hamiltonian. */
@@ -52,7 +54,28 @@ class GreensFunction : public Thermal, public ComputableObject {
      */
     std::list<GreensFunctionPart*> parts;
 
+    typedef Eigen::Array<RealType,Eigen::Dynamic,1> RealArrayType;
+    /** Poles of all parts, collected into a contiguous sorted array after compute().
+     * Poles of different parts closer than ReduceResonanceTolerance are merged. */
+    RealArrayType Poles;
+    /** Real and imaginary parts of the residues at the Poles. */
+    RealArrayType ResiduesRe, ResiduesIm;
+
+    /** Collects the terms of all parts into Poles, ResiduesRe and ResiduesIm, merges the close poles
+     * and drops the smallest residues within SpectralWeightTolerance. */
+    void collectTerms();
+    /** Returns a sum of all collected terms at a given frequency. The sum over the poles is vectorized. */
+    ComplexType evaluateTerms(ComplexType z) const;
+
 public:
+    /** Storage layout of the lists of terms in the parts. default = TreeStorage. */
+    TermStorage TermsStorage;
+    /** Poles of different parts closer than this value are merged into one. default = 1e-8. */
+    RealType ReduceResonanceTolerance;
+    /** The terms with the smallest residues are dropped, as long as the sum of their magnitudes
+     * does not exceed this fraction of the total spectral weight sum |R|. default = 0 (no terms are dropped). */
+    RealType SpectralWeightTolerance;
+
      /** Constructor.
      * \param[in] S A reference to a states classification object.
      * \param[in] H A reference to a Hamiltonian.
@@ -71,10 +94,12 @@ public:
 
     /** Chooses relevant parts of C and CX and allocates resources for the parts of the Green's function. */
     void prepare(void);
-    /** Actually computes the parts and fills the internal cache of precomputed values.
+    /** Actually computes the parts (concurrently with OpenMP) and fills the internal cache of precomputed values.
      * \param[in] NumberOfMatsubaras Number of positive Matsubara frequencies.
      */
     void compute();
+    /** Returns an estimate of the cost of compute(), the sum of the complexities of the parts. */
+    RealType getComplexity() const;
 
     /** Returns the 'bit' (index) of the operator C or CX.
      * \param[in] Position Use C for Position==0 and CX for Position==1.
@@ -91,11 +116,33 @@ public:
      */
     ComplexType operator()(ComplexType z) const;
 
+    /** Evaluates the Green's function on a grid of complex frequencies at once.
+     * The poles and residues of all parts are stored in contiguous arrays, the sum over them
+     * is vectorized and the frequencies are distributed among OpenMP threads.
+     * \param[in] grid Input frequencies.
+     * \param[out] out Values of the Green's function, resized to the size of the grid.
+     */
+    void evaluate(const ComplexVectorType& grid, ComplexVectorType& out) const;
+
+    /** Returns the merged poles and residues of the Green's function, sorted by the poles.
+     * \param[out] Poles Positions of the poles.
+     * \param[out] Residues Residues at the poles.
+     */
+    void getTerms(std::vector<RealType>& Poles, std::vector<ComplexType>& Residues) const;
+
      /** Returns the value of the Green's function calculated at a given imaginary time point.
      * \param[in] tau Imaginary time point.
      */
     ComplexType of_tau(RealType tau) const;
 
+     /** Evaluates the Green's function on a uniform imaginary time grid \f$ \tau_k = \beta k/(ntau-1) \f$, k = 0..ntau-1.
+     * The exponentials of every pole are obtained by a recurrence along the grid (one multiplication per point),
+     * which is restarted with the exact values in every chunk of the grid. The chunks are distributed among OpenMP threads.
+     * \param[in] ntau Number of points on the grid, including 0 and beta.
+     * \param[out] out Values of the Green's function, resized to ntau.
+     */
+    void of_tau_grid(long ntau, ComplexVectorType& out) const;
+
     bool isVanishing(void) const;
 };
 
@@ -104,22 +151,7 @@ inline ComplexType GreensFunction::operator()(long int MatsubaraNumber) const {
 
 inline ComplexType GreensFunction::operator()(ComplexType z) const {
     if(Vanishing) return 0;
-    else {
-        ComplexType Value = 0;
-        for(std::list<GreensFunctionPart*>::const_iterator iter = parts.begin(); iter != parts.end(); iter++)
-            Value += (**iter)(z);
-        return Value;
-    };
-}
-
-inline ComplexType GreensFunction::of_tau(RealType tau) const {
-    if(Vanishing) return 0;
-    else {
-        ComplexType Value = 0;
-        for(std::list<GreensFunctionPart*>::const_iterator iter = parts.begin(); iter != parts.end(); iter++)
-            Value += (*iter)->of_tau(tau);
-        return Value;
-    };
+    else return evaluateTerms(z);
 }
 
 } // end of namespace Pomerol
@@ -116,9 +116,25 @@ public:
                        const HamiltonianPart& HpartInner, const HamiltonianPart& HpartOuter,
                        const DensityMatrixPart& DMpartInner, const DensityMatrixPart& DMpartOuter);
 
+    /** Sets the storage layout of the list of terms.
+     * \param[in] Storage Storage layout.
+     */
+    void setTermStorage(TermStorage Storage);
+
     /** Iterates over all matrix elements and fills the list of terms. */
     void compute(void);
 
+    /** Returns an estimate of the cost of compute(): the number of visited outer indices and non-zero elements
+     * plus the expected number of terms, derived from the numbers of non-zero elements of C and CX.
+     */
+    RealType getComplexity() const;
+
+    /** Appends the poles and the residues of all terms to the given vectors.
+     * \param[in,out] Poles Positions of the poles.
+     * \param[in,out] Residues Residues at the poles.
+     */
+    void getTerms(std::vector<RealType>& Poles, std::vector<ComplexType>& Residues) const;
+
     /** Returns a sum of all the terms with a substituted frequency.
     * \param[in] z Input frequency
     */
@@ -37,6 +37,15 @@ class Hamiltonian : public ComputableObject
     /** A value of the ground energy - needed for further renormalization */
     RealType GroundEnergy;
 public:
+    /** Blocks of at least this size are stored as sparse matrices, and only their eigenpairs with energies
+     * up to getGroundEnergy() + EnergyWindow are computed with the Davidson method. default = 0 (all blocks are dense). */
+    InnerQuantumState SparseBlockSize;
+    /** The energy window for the sparse blocks. Besides the thermally populated states, it must contain the intermediate
+     * states of the matrix elements entering the Green's functions, i.e. it should cover the excitation energies
+     * relevant for the GF/2PGF (the bandwidth plus the interaction), not just several temperatures. default = 10. */
+    RealType EnergyWindow;
+    /** Convergence threshold for the residuals of the eigenvectors of the sparse blocks. default = 1e-10. */
+    RealType EigenTolerance;
 
     /** Constructor. */
     Hamiltonian(const IndexClassification &IndexInfo, const IndexHamiltonian& F, const StatesClassification &S);
@@ -49,6 +58,8 @@ public:
 
     const HamiltonianPart& getPart(const QuantumNumbers &in) const;
     const HamiltonianPart& getPart(BlockNumber in) const;
+    /** Returns the eigenvalue numbered by the InnerQuantumState of a Fock state in its block.
+     *  Sparse parts expose only the eigenvalues within EnergyWindow, a state above them throws StatesClassification::exWrongState. */
     RealType getEigenValue(unsigned long state) const;
     RealVectorType getEigenValues() const;
     RealType getGroundEnergy() const;
@@ -62,6 +73,8 @@ public:
 
 private:
     void computeGroundEnergy();
+    /** Diagonalizes the given parts in parallel and distributes the results to all processes. */
+    void computeParts(const std::vector<BlockNumber>& Blocks, const boost::mpi::communicator &comm);
 };
 
 } // end of namespace Pomerol
@@ -39,6 +39,19 @@ class HamiltonianPart : public ComputableObject {
     /** A vector of eigenvalues of the HamiltonianPart. */
     RealVectorType Eigenvalues;      
 
+    /** Store the block as a sparse matrix and compute only its lowest eigenpairs. default = false. */
+    bool Sparse;
+    /** A sparse matrix filled with matrix elements of HamiltonianPart (only in the sparse mode).
+     *  The eigenvectors are still stored in the columns of H, which then has as many columns as computed eigenvalues. */
+    ColMajorMatrixType HSparse;
+    /** In the sparse mode only the eigenpairs with energies up to this value are computed (but at least one). default = +inf. */
+    RealType EnergyCutoff;
+    /** In the sparse mode an eigenpair is converged, when the norm of its residual is less than this value. default = 1e-10. */
+    RealType Tolerance;
+
+    /** Finds the eigenpairs below EnergyCutoff with the Davidson method (the sparse mode). */
+    void computeLowest();
+
     friend class Hamiltonian;
 
 public:
@@ -52,7 +65,7 @@ public:
 
     /** Fill in the H matrix. */
     void prepare(void);
-    /** Diagonalize the H matrix and get EigenValues. */
+    /** Diagonalize the H matrix and get EigenValues. In the sparse mode only the eigenvalues up to EnergyCutoff are obtained. */
     void compute(void);
     
     bool reduce(RealType ActualCutoff); // Useless now
@@ -60,16 +73,21 @@ public:
     /** Return the total dimensionality of the H matrix. This corresponds to the one in StatesClassfication. */
     InnerQuantumState getSize(void) const;
 
+    /** Returns an estimate of the cost of compute(): N^3 for a full diagonalization, and the cost of
+     *  the Davidson iterations for the eigenpairs expected below EnergyCutoff in the sparse mode. */
+    RealType getComplexity() const;
+
     /** Get the matrix element of the HamiltonianPart by the number of states inside the part. */ 
     MelemType getMatrixElement(InnerQuantumState m, InnerQuantumState n) const; //return H(m,n)
     /** Get the matrix element of the Hamiltonian within two given FockStates. */
     MelemType getMatrixElement(FockState m, FockState n) const; //return H(m,n)
 
-    /** Get the eigenvalue of the H matrix.
+    /** Get the eigenvalue of the H matrix. A sparse part holds only the eigenpairs computed within EnergyCutoff,
+     *  a higher number throws StatesClassification::exWrongState.
      * \param[in] Number of eigenvalue. */
     RealType getEigenValue(InnerQuantumState state) const; 
 
-    /** Returns calculated eigenvalues. */
+    /** Returns calculated eigenvalues. In the sparse mode there may be less eigenvalues than getSize(). */
     const RealVectorType& getEigenValues() const; 
 
     /** Return the hamiltonian part matrix. */
@@ -77,7 +95,7 @@ public:
 
     /** Return the lowest Eigenvalue of the current part. */
     RealType getMinimumEigenvalue() const;        
-    /** Return the eigenstate of the H matrix.
+    /** Return the eigenstate of the H matrix. Throws StatesClassification::exWrongState beyond the computed eigenstates.
      * \param[in] Number of eigenvalue. */
     VectorType getEigenState(InnerQuantumState state) const;
 
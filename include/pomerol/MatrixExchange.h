@@ -0,0 +1,121 @@
+/** \file include/pomerol/MatrixExchange.h
+** \brief Packed exchange of dense and sparse matrices computed by different MPI processes.
+*/
+#ifndef __INCLUDE_MATRIXEXCHANGE_H
+#define __INCLUDE_MATRIXEXCHANGE_H
+
+#include "Misc.h"
+
+namespace Pomerol{
+
+/** Distributes matrices (and arrays), each of them known only to the process which has computed it, to all processes.
+ * The dimensions of all matrices are exchanged first, so that the receiving processes resize the matrices.
+ * Then every process broadcasts all matrices it owns at once, directly from and into their storage, instead of
+ * issuing a broadcast per matrix. The matrices must be added in the same order on all processes.
+ * Nothing is exchanged on a single process.
+ */
+class MatrixExchange {
+public:
+    /** Constructor.
+     * \param[in] comm MPI communicator of all processes taking part in the exchange.
+     */
+    MatrixExchange(const boost::mpi::communicator& comm);
+
+    /** Adds a dense matrix or vector.
+     * \param[in,out] m The matrix, which is read on the process owner and overwritten on the other processes.
+     * \param[in] owner The rank of the process, which holds the matrix.
+     */
+    template <typename Scalar, int Rows, int Cols, int Options, int MaxRows, int MaxCols>
+    void add(Eigen::Matrix<Scalar,Rows,Cols,Options,MaxRows,MaxCols>& m, int owner)
+    { Items.push_back(boost::make_shared<DenseItem<Eigen::Matrix<Scalar,Rows,Cols,Options,MaxRows,MaxCols> > >(m, owner)); };
+    /** Adds a dense array.
+     * \param[in,out] m The array, which is read on the process owner and overwritten on the other processes.
+     * \param[in] owner The rank of the process, which holds the array.
+     */
+    template <typename Scalar, int Rows, int Cols, int Options, int MaxRows, int MaxCols>
+    void add(Eigen::Array<Scalar,Rows,Cols,Options,MaxRows,MaxCols>& m, int owner)
+    { Items.push_back(boost::make_shared<DenseItem<Eigen::Array<Scalar,Rows,Cols,Options,MaxRows,MaxCols> > >(m, owner)); };
+    /** Adds a sparse matrix. It is compressed on the process owner before the exchange.
+     * \param[in,out] m The matrix, which is read on the process owner and overwritten on the other processes.
+     * \param[in] owner The rank of the process, which holds the matrix.
+     */
+    template <typename Scalar, int Options, typename StorageIndex>
+    void add(Eigen::SparseMatrix<Scalar,Options,StorageIndex>& m, int owner)
+    { Items.push_back(boost::make_shared<SparseItem<Eigen::SparseMatrix<Scalar,Options,StorageIndex> > >(m, owner)); };
+
+    /** Performs the exchange. Must be called on all processes of the communicator. */
+    void run();
+
+protected:
+    /** A matrix taking part in the exchange. */
+    struct Item {
+        int owner;
+        Item(int owner) : owner(owner) {};
+        virtual ~Item() {};
+        /** Appends the dimensions of the matrix to dims. */
+        virtual void getDimensions(std::vector<long>& dims) = 0;
+        /** Resizes the matrix to the dimensions read from pos and advances the position. */
+        virtual void resize(const long*& pos) = 0;
+        /** Appends the addresses and the sizes in bytes of the storage of the matrix. */
+        virtual void getStorage(std::vector<MPI_Aint>& addresses, std::vector<size_t>& sizes) = 0;
+    };
+
+    template <typename MatrixT> struct DenseItem : public Item {
+        MatrixT& m;
+        DenseItem(MatrixT& m, int owner) : Item(owner), m(m) {};
+        void getDimensions(std::vector<long>& dims)
+        {
+            dims.push_back(m.rows());
+            dims.push_back(m.cols());
+        };
+        void resize(const long*& pos)
+        {
+            m.resize(pos[0], pos[1]);
+            pos += 2;
+        };
+        void getStorage(std::vector<MPI_Aint>& addresses, std::vector<size_t>& sizes)
+        {
+            addStorage(addresses, sizes, m.data(), m.size());
+        };
+    };
+
+    template <typename SparseT> struct SparseItem : public Item {
+        SparseT& m;
+        SparseItem(SparseT& m, int owner) : Item(owner), m(m) {};
+        void getDimensions(std::vector<long>& dims)
+        {
+            m.makeCompressed();
+            dims.push_back(m.rows());
+            dims.push_back(m.cols());
+            dims.push_back(m.nonZeros());
+        };
+        void resize(const long*& pos)
+        {
+            m.resize(pos[0], pos[1]);
+            m.resizeNonZeros(pos[2]);
+            pos += 3;
+        };
+        void getStorage(std::vector<MPI_Aint>& addresses, std::vector<size_t>& sizes)
+        {
+            // The outer indices of a resized matrix are not received yet, so nonZeros() would be 0
+            addStorage(addresses, sizes, m.outerIndexPtr(), m.outerSize() + 1);
+            addStorage(addresses, sizes, m.innerIndexPtr(), m.data().size());
+            addStorage(addresses, sizes, m.valuePtr(), m.data().size());
+        };
+    };
+
+    template <typename T> static void addStorage(std::vector<MPI_Aint>& addresses, std::vector<size_t>& sizes, T* data, size_t n)
+    {
+        if (!n) return;
+        MPI_Aint address;
+        MPI_Get_address(data, &address);
+        addresses.push_back(address);
+        sizes.push_back(n*sizeof(T));
+    };
+
+    boost::mpi::communicator Comm;
+    std::vector<boost::shared_ptr<Item> > Items;
+};
+
+} // end of namespace Pomerol
+#endif // endif :: #ifndef __INCLUDE_MATRIXEXCHANGE_H
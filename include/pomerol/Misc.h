@@ -42,6 +42,8 @@
 
 #include <boost/mpi.hpp>
 
+#include "FockState.h"
+
 #define REALTYPE_DOUBLE
 
 namespace Pomerol{
@@ -76,7 +78,11 @@ typedef unsigned int ParticleIndex;
 //typedef AtomicOp<1,fermion,ParticleIndex> AtomicCdag;
 
 /** Fock State representation. */
+#ifdef POMEROL_FIXED_FOCKSTATE
+typedef FixedFockState FockState;
+#else
 typedef boost::dynamic_bitset<> FockState;
+#endif
 const FockState ERROR_FOCK_STATE = FockState(); // A state with the size==0 is an error state
 
 /** Each Quantum State in the finite system is associated with a number.
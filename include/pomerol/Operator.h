@@ -335,6 +335,100 @@ protected:
 
 };
 
+/** A compiled form of an Operator for acting on Fock states of up to 64 modes, given as integers.
+ * The monomials are stored as a flat list of elementary creation/annihilation steps with bit masks,
+ * so that acting on a state needs neither allocations nor intermediate maps.
+ */
+class CompiledOperator {
+public:
+    typedef boost::uint64_t mask_type;
+
+    /** Constructor.
+     * \param[in] op An operator to compile.
+     */
+    CompiledOperator(const Operator& op);
+
+    /** Acts with the operator on a state and passes every resulting state with its matrix element
+     * to emit(bra, melem). A bra may be emitted several times, the matrix elements are to be summed up.
+     * \param[in] ket A state to act on.
+     * \param[in] emit A callable object taking (QuantumState, MelemType).
+     */
+    template <typename Emitter> void actRight(QuantumState ket, Emitter& emit) const;
+
+    /** Returns the diagonal matrix element <state|op|state>. It is cheap for a linear combination of
+     * occupation numbers (e.g. N or Sz), which is evaluated with a popcount per distinct coefficient.
+     * \param[in] state A state.
+     */
+    MelemType getDiagonalElement(QuantumState state) const;
+
+    /** Returns true if the operator is a linear combination of occupation numbers and a constant. */
+    bool isNumberOperatorsOnly() const { return NumberOperatorsOnly; }
+
+protected:
+    /** An elementary operator of a monomial. */
+    struct Step {
+        /** The bit of the mode. */
+        mask_type Mask;
+        /** The bits of the modes below, which give the fermionic sign. */
+        mask_type Below;
+        /** The value of the bit required before the step: 0 for creation, Mask for annihilation. */
+        mask_type Required;
+    };
+    /** Steps of all monomials in the order of application (right to left). */
+    std::vector<Step> Steps;
+    /** Positions of the first step of every monomial in Steps, followed by Steps.size(). */
+    std::vector<size_t> MonomialStart;
+    /** Coefficients of the monomials. */
+    std::vector<MelemType> Coefficients;
+
+    /** True if the operator is a linear combination of occupation numbers and a constant. */
+    bool NumberOperatorsOnly;
+    /** The modes having the same coefficient in the linear combination of occupation numbers. */
+    std::vector<mask_type> NumberMasks;
+    /** The distinct coefficients in the linear combination of occupation numbers. */
+    std::vector<MelemType> NumberWeights;
+    /** The constant term. */
+    MelemType Constant;
+
+    /** A callable object for actRight(), which sums up the diagonal matrix elements. */
+    struct DiagonalSum {
+        QuantumState State;
+        MelemType Value;
+        DiagonalSum(QuantumState State) : State(State), Value(0) {};
+        void operator()(QuantumState bra, MelemType melem) { if (bra == State) Value += melem; };
+    };
+};
+
+template <typename Emitter>
+inline void CompiledOperator::actRight(QuantumState ket, Emitter& emit) const
+{
+    for (size_t m = 0; m < Coefficients.size(); ++m) {
+        mask_type bra = ket;
+        mask_type parity = 0;
+        size_t s = MonomialStart[m];
+        for (; s < MonomialStart[m+1]; ++s) {
+            const Step& step = Steps[s];
+            if ((bra & step.Mask) != step.Required) break; // This is Pauli principle.
+            parity ^= FixedFockState::popcount(bra & step.Below);
+            bra ^= step.Mask;
+        }
+        if (s == MonomialStart[m+1]) emit(QuantumState(bra), (parity & 1) ? MelemType(-Coefficients[m]) : Coefficients[m]);
+    }
+}
+
+inline MelemType CompiledOperator::getDiagonalElement(QuantumState state) const
+{
+    if (NumberOperatorsOnly) {
+        MelemType value = Constant;
+        for (size_t i = 0; i < NumberMasks.size(); ++i)
+            value += NumberWeights[i] * MelemType(FixedFockState::popcount(state & NumberMasks[i]));
+        return value;
+    }
+    DiagonalSum sum(state);
+    actRight(state, sum);
+    return sum.Value;
+}
+
 // Free functions to make creation/annihilation operators
 namespace OperatorPresets {
 inline Operator c(ParticleIndex index) {
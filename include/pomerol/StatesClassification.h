@@ -15,6 +15,8 @@
 #include "Operator.h"
 #include "Symmetrizer.h"
 
+#include <boost/unordered_map.hpp>
+
 namespace Pomerol{
 
 /** A small wrapper around int to hold a number of block. 
@@ -35,24 +37,50 @@ class StatesClassification : public ComputableObject {
 
     /** A map between all BlockNumbers and QuantumNumbers */
     std::map<BlockNumber,QuantumNumbers> BlockToQuantum;
-    /** A map between all QuantumNumbers and BlockNumbers */
-    std::map<QuantumNumbers,BlockNumber> QuantumToBlock;
-    /** A storage for all FockStates, each subvector correspond to the states which belong to a block with a given BlockNumber. */
+    /** A hash table between all QuantumNumbers and BlockNumbers */
+    boost::unordered_map<QuantumNumbers,BlockNumber> QuantumToBlock;
+    /** A storage for all FockStates, each subvector correspond to the states which belong to a block with a given BlockNumber.
+     *  The states of a block are sorted. */
     std::vector<std::vector<FockState> > StatesContainer;
-    /** Index all states to belong to a block. */
-    std::vector<BlockNumber> StateBlockIndex;
+    /** The modes having the same weights in all symmetry operations. Empty, if the states were classified by a scan. */
+    std::vector<QuantumState> ClassMasks;
+    /** The class of every mode. */
+    std::vector<int> ModeClasses;
+    /** The numbers of modes of every class below every mode, stored as [mode*ClassMasks.size() + class]. */
+    std::vector<int> ModesBelow;
+    /** The numbers of occupied modes of every class for all generated blocks. A block consists of one or several
+     *  sets of occupation numbers, stored one after another as [set*ClassMasks.size() + class]. */
+    std::vector<std::vector<int> > Occupations;
+    /** Binomial coefficients C(n,k) for n,k <= IndexSize. */
+    std::vector<std::vector<QuantumState> > Binomials;
+    /** The symmetry operations of Symm, compiled to evaluate the quantum numbers of a state without temporaries. */
+    std::vector<CompiledOperator> SymmetryOperations;
 
     /** A reference to an IndexClassification object */
     const IndexClassification &IndexInfo;
     /** A reference to a Symmetrizer object. This will be used for classification of the states. */
     const Symmetrizer &Symm;
+
+    /** Evaluates the quantum numbers of a state.
+     * \param[in] state A state.
+     * \param[out] QNumbers The values of all symmetry operations.
+     */
+    void evaluateQuantumNumbers(QuantumState state, QuantumNumbers& QNumbers) const;
+    /** Classifies the Fock states by evaluating the quantum numbers of each of them. */
+    void classifyAllStates();
+    /** Generates the Fock states of every block directly, when all symmetry operations are linear combinations
+     *  of occupation numbers (e.g. N, Sz or the charges found by Symmetrizer). Returns false otherwise. */
+    bool generateBlocks();
+    /** Returns the number of states with the given numbers of occupied modes of every class, which are lower than state. */
+    QuantumState countLowerStates(QuantumState state, const int* occupations) const;
 public:        
     /** Constructor
      * \param[in] IndexInfo A reference to an IndexClassification object
      */
     StatesClassification(const IndexClassification& IndexInfo, const Symmetrizer &Symm);
 
-    /** Perform a classification of all FockStates */
+    /** Perform a classification of all FockStates. The states of a block are generated combinatorially from
+     *  the occupation numbers, when the symmetry operations allow it, and are found by a scan of all states otherwise. */
     void compute();
 
    /** get total number of Quantum States ( 2^IndexInfo.size() ) */
@@ -77,6 +105,12 @@ public:
      */
     const InnerQuantumState getInnerState( FockState state) const;
     const InnerQuantumState getInnerState( QuantumState state) const;
+    /** get InnerQuantumState of a given FockState, which is known to belong to a given block.
+     *  The state is ranked combinatorially in a generated block and found by a binary search otherwise.
+     * \param[in] in The BlockNumber of the state
+     * \param[in] state FockState for which the correspondence is required
+     */
+    const InnerQuantumState getInnerState( BlockNumber in, QuantumState state) const;
 
     /** Returns a number of Block which corresponds to given Quantum Numbers 
      * \param[in] in A set of QuantumNumbers to find corresponding BlockNumber
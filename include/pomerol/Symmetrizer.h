@@ -13,6 +13,7 @@
 #include "IndexHamiltonian.h"
 #include "ComputableObject.h"
 #include <boost/functional/hash.hpp>
+#include <boost/cstdint.hpp>
 #include <set>
 
 namespace Pomerol{
@@ -39,17 +40,34 @@ private:
     /** Total amount of indices in the system. */
     ParticleIndex IndexSize;
 
-    /** A list of equivalent lattice sites permutations. */
-    std::list<IndexPermutation*> Permutations;
+    /** Permutations of indices, which leave the Hamiltonian invariant. Index i is mapped to Permutations[n].getIndex(i). */
+    std::vector<DynamicIndexCombination> Permutations;
     /** Total amount of symmetries found. */
     int NSymmetries;
     /** A vector of operators that commute with the Hamiltonian. */
     std::vector<boost::shared_ptr<Operator> > Operations;
+    /** For every operation - the modulus, by which its eigenvalues are taken, or 0 if they are used as is. */
+    std::vector<int> Moduli;
 
+    /** Adds an operation to the list of symmetries, if there is room for it. */
+    bool addSymmetry(const Operator &in, int modulus);
+    /** Finds the conserved charges sum_i q_i n_i and the conserved parities (sum_i q_i n_i) mod 2,
+     * which are not implied by the already found symmetries. The charges are read off from the
+     * change of the occupation numbers by every monomial of the Hamiltonian. */
+    void findAbelianSymmetries();
 
-    /** This method finds all possible symmetry operations. */ /** lattice permutation operators, that commute with the hamiltonian. */
-    //void findLatticeSymmetry();
+
+    /** Finds a generating set of the group of index permutations, which leave the Hamiltonian invariant,
+     * e.g. lattice translations, reflections or spin flips. */
+    void findPermutations();
 public:
+    /** If true, compute() also looks for the conserved occupation charges and parities beyond N and Sz,
+     * e.g. the orbital-resolved occupations or their parities, to split the Hamiltonian into smaller blocks. default = false. */
+    bool FindAbelianSymmetries;
+    /** If true, compute() also looks for the index permutations, which leave the Hamiltonian invariant.
+     * They do not split the Hamiltonian, but relate the components of the Green's functions. default = false. */
+    bool FindPermutations;
+
     Symmetrizer(const IndexClassification &IndexInfo, const IndexHamiltonian &Storage);
     /** This method checks several possible symmetry operations (generated by N and S_z integrals of motion)
      *  to split the Hamiltonian into blocks.
@@ -61,6 +79,10 @@ public:
     bool checkSymmetry(const Operator &in);
     /** Get a vector of operators that commute with the Hamiltonian. */
     const std::vector<boost::shared_ptr<Operator> >& getOperations() const;
+    /** Get a generating set of the index permutations, which leave the Hamiltonian invariant (found if FindPermutations is set). */
+    const std::vector<DynamicIndexCombination>& getPermutations() const;
+    /** Get the moduli of the eigenvalues of the operations (0 - no modulus, 2 - a parity). */
+    const std::vector<int>& getModuli() const;
     /** Get a sample QuantumNumbers. Their amount is set. */
     QuantumNumbers getQuantumNumbers() const;
 };
@@ -102,31 +124,41 @@ public:
 
 };
 
-/** This class represents a set of quantum numbers obtained by the Symmetrizer. */
+/** This class represents a set of quantum numbers obtained by the Symmetrizer.
+ * The eigenvalues of the symmetry operations are stored as integers, rounded on a grid of step 1/Resolution
+ * (exact for integer and half-integer numbers, e.g. N and Sz). Comparisons are exact, and a hash is
+ * provided for unordered containers. */
 struct Symmetrizer::QuantumNumbers {
 friend class Symmetrizer;
+public:
+    /** Maximal number of quantum numbers. */
+    static const int MaxAmount = 16;
+    /** Inverse step of the grid, on which the quantum numbers are stored. */
+    static const boost::int64_t Resolution = 1 << 16;
 private:
     /** Total number of quantum numbers. */
     int amount;
-    /** A vector of numbers. For now set as MelemType. */
-    std::vector<MelemType> numbers;
+    /** The quantum numbers multiplied by Resolution. */
+    boost::int64_t numbers[MaxAmount];
     /** Private constuctor - can be called only inside Symmetrizer. */
     QuantumNumbers(int amount);
-    /** A hash of the quantum numbers - used for comparison. */
-    std::size_t NumbersHash;
-    /** Hash generator. */
-    boost::hash<std::vector<MelemType> > numbers_hash_generator;
 public:
     /** Set a quantum number at the given position to a value
      * \param[in] pos Position of QuantumNumber, e.g. the number of operation in Symmetrizer::Operations.
-     * \param[in] val Value of QuantumNumber.
+     * \param[in] val Value of QuantumNumber. The imaginary part (if any) is ignored, since the symmetry operations are hermitian.
      */
     bool set ( int pos, MelemType val );
+    /** Returns the value of a quantum number.
+     * \param[in] pos Position of QuantumNumber.
+     */
+    RealType get ( int pos ) const;
 
     /* Comparison operators. */
     bool operator< (const QuantumNumbers& rhs) const ;
     bool operator== (const QuantumNumbers& rhs) const ;
     bool operator!= (const QuantumNumbers& rhs) const ;
+    /** A hash for boost::unordered containers. */
+    friend std::size_t hash_value(const QuantumNumbers& in) { return boost::hash_range(in.numbers, in.numbers + in.amount); };
     /** Output to external stream */
     friend std::ostream& operator<<(std::ostream& output, const QuantumNumbers& out);
     /** Exception for bad quantum numbers. */
@@ -7,21 +7,37 @@
 #define __INCLUDE_TERMLIST_H
 
 #include <set>
+#include <vector>
+#include <algorithm>
+#include <iterator>
 #include <boost/preprocessor/repetition/enum_params.hpp>
 #include <boost/preprocessor/repetition/enum_binary_params.hpp>
 #include <boost/serialization/set.hpp>
+#include <boost/serialization/vector.hpp>
 
 #include "Misc.h"
 
 namespace Pomerol {
 
+/** Storage layout of a TermList. */
+enum TermStorage {
+    /** Terms are kept in a std::set, like terms are reduced on every insertion. */
+    TreeStorage,
+    /** Terms are appended to a contiguous buffer and like terms are reduced in bulk by sorting and merging. */
+    FlatStorage
+};
+
 /** Container storing a list of terms (instances of TermType).
  *
  * The terms must allow sorting using a comparison function TermType::Compare.
  * Like terms (equivalent w.r.t. TermType::Compare) are automatically collected
  * and reduced to one term using operator+=().
- * A term T is considered negligible and is automatically removed from the
- * container if TermType::IsNegligible(T, current_number_of_terms + 1) evaluates to true.
+ * A sum of like terms T is considered negligible and is automatically removed from the
+ * container if TermType::IsNegligible(T, current_number_of_terms) evaluates to true.
+ *
+ * With FlatStorage the reduction is deferred: new terms are appended to a vector,
+ * which is sorted and merged every time the unreduced tail outgrows the reduced
+ * head, and finally by an explicit call to reduce().
  */
 template<typename TermType> class TermList {
 
@@ -33,19 +49,57 @@ template<typename TermType> class TermList {
     std::set<TermType, Compare> data;
     IsNegligible is_negligible;
 
+    /** Storage layout in use */
+    TermStorage storage;
+    /** Terms in the FlatStorage mode */
+    std::vector<TermType> flat_data;
+    /** Number of terms at the beginning of flat_data, which are already sorted and reduced */
+    std::size_t flat_reduced;
+
+    /** Minimal length of the unreduced tail of flat_data that triggers a reduction */
+    static std::size_t min_flat_tail() { return 1<<16; }
+
 public:
 
     /** Constructor.
      * \param[in] compare Compare predicate for the underlying std::set object
      * \param[in] is_negligible Predicate that determines whether a term can be neglected
+     * \param[in] storage Storage layout of the container
+     */
+    TermList(Compare const& compare, IsNegligible const& is_negligible, TermStorage storage = TreeStorage) :
+        data(compare), is_negligible(is_negligible), storage(storage), flat_reduced(0) {}
+
+    /** Returns the storage layout of the container */
+    TermStorage get_storage() const { return storage; }
+
+    /** Change the storage layout of the container, existing terms are preserved.
+     * \param[in] new_storage New storage layout
      */
-    TermList(Compare const& compare, IsNegligible const& is_negligible) :
-        data(compare), is_negligible(is_negligible) {}
+    void set_storage(TermStorage new_storage) {
+        if(new_storage == storage) return;
+        if(new_storage == FlatStorage) {
+            flat_data.assign(data.begin(), data.end());
+            flat_reduced = flat_data.size();
+            data.clear();
+        } else {
+            reduce();
+            data.insert(flat_data.begin(), flat_data.end());
+            std::vector<TermType>().swap(flat_data);
+            flat_reduced = 0;
+        }
+        storage = new_storage;
+    }
 
     /** Add a new term to the container
      * \param[in] term Term to be added
      */
     void add_term(TermType const& term) {
+        if(storage == FlatStorage) {
+            flat_data.push_back(term);
+            if(flat_data.size() - flat_reduced > std::max(flat_reduced, min_flat_tail()))
+                reduce();
+            return;
+        }
         typename std::set<TermType, Compare>::iterator it = data.find(term);
         if(it == data.end()) { // new term
             data.insert(term);
@@ -58,17 +112,88 @@ public:
         }
     }
 
-    /** Number of terms in the container */
-    std::size_t size() const { return data.size(); }
+    /** Add all terms of another container to this one
+     * \param[in] other Container to take the terms from
+     */
+    void add_terms(TermList const& other) {
+        if(storage == FlatStorage) {
+            other.copy_terms(std::back_inserter(flat_data));
+            reduce();
+            return;
+        }
+        if(other.storage == FlatStorage) {
+            for(typename std::vector<TermType>::const_iterator it = other.flat_data.begin(); it != other.flat_data.end(); ++it)
+                add_term(*it);
+        } else {
+            for(typename std::set<TermType, Compare>::const_iterator it = other.data.begin(); it != other.data.end(); ++it)
+                add_term(*it);
+        }
+    }
+
+    /** Collect like terms and remove negligible ones. Only the FlatStorage mode
+     * needs this to be called; it must be done before the container is checked
+     * with check_terms() and preferably before it is evaluated.
+     */
+    void reduce() {
+        if(storage != FlatStorage || flat_reduced == flat_data.size()) return;
+
+        Compare compare = data.key_comp();
+        typename std::vector<TermType>::iterator head_end = flat_data.begin() + flat_reduced;
+        // Merge sort algorithms never access elements out of range,
+        // even though the tolerance-based comparison is not transitive.
+        std::stable_sort(head_end, flat_data.end(), compare);
+        std::inplace_merge(flat_data.begin(), head_end, flat_data.end(), compare);
+
+        // Collect like terms, remembering which of the sums have been merged from several terms
+        std::vector<bool> merged;
+        typename std::vector<TermType>::iterator out = flat_data.begin();
+        typename std::vector<TermType>::iterator it = flat_data.begin();
+        while(it != flat_data.end()) {
+            TermType sum = *it;
+            bool is_merged = false;
+            for(++it; it != flat_data.end() && !compare(sum, *it); ++it) { sum += *it; is_merged = true; }
+            *out++ = sum;
+            merged.push_back(is_merged);
+        }
+        flat_data.erase(out, flat_data.end());
+
+        // As in the TreeStorage mode, only sums of like terms can be neglected,
+        // and the tolerance is divided by the number of terms in the list.
+        std::size_t n_terms = flat_data.size();
+        out = flat_data.begin();
+        for(std::size_t n = 0; n < n_terms; ++n) {
+            if(!(merged[n] && is_negligible(flat_data[n], n_terms))) *out++ = flat_data[n];
+        }
+        flat_data.erase(out, flat_data.end());
+        flat_reduced = flat_data.size();
+    }
+
+    /** Copy all terms to an output iterator
+     * \param[out] out Output iterator
+     */
+    template<typename OutputIterator> OutputIterator copy_terms(OutputIterator out) const {
+        if(storage == FlatStorage) return std::copy(flat_data.begin(), flat_data.end(), out);
+        return std::copy(data.begin(), data.end(), out);
+    }
+
+    /** Number of terms in the container (including not yet reduced ones in the FlatStorage mode) */
+    std::size_t size() const { return storage == FlatStorage ? flat_data.size() : data.size(); }
 
     /** Remove all terms from the container */
-    void clear() { data.clear(); }
+    void clear() { data.clear(); std::vector<TermType>().swap(flat_data); flat_reduced = 0; }
 
     // Some pre-C++11 ugliness ...
 #define MAKE_CALL_OPERATOR(N)                                               \
     template<BOOST_PP_ENUM_PARAMS(N, typename Arg)>                         \
     ComplexType operator()(BOOST_PP_ENUM_BINARY_PARAMS(N, Arg, arg)) const {\
         ComplexType res = 0;                                                \
+        if(storage == FlatStorage) {                                        \
+            for(typename std::vector<TermType>::const_iterator              \
+                it = flat_data.begin(); it != flat_data.end(); ++it) {      \
+                res += (*it)(BOOST_PP_ENUM_PARAMS(N, arg));                 \
+            }                                                               \
+            return res;                                                     \
+        }                                                                   \
         for(typename std::set<TermType>::const_iterator it = data.begin();  \
             it != data.end(); ++it) {                                       \
             res += (*it)(BOOST_PP_ENUM_PARAMS(N, arg));                     \
@@ -89,10 +214,20 @@ public:
     friend class boost::serialization::access;
     template<class Archive> void serialize(Archive & ar, const unsigned int version) {
         ar & data; ar & is_negligible;
+        ar & storage; ar & flat_data; ar & flat_reduced;
     }
 
     /** Check that all terms in the container are properly ordered and are not negligible */
     bool check_terms() {
+        if(storage == FlatStorage) {
+            if(flat_reduced != flat_data.size()) return false;
+            Compare const& compare = data.key_comp();
+            for(std::size_t n = 0; n < flat_data.size(); ++n) {
+                if(is_negligible(flat_data[n], flat_data.size() + 1)) return false;
+                if(n > 0 && !compare(flat_data[n-1], flat_data[n])) return false;
+            }
+            return true;
+        }
         if(size() == 0) return true;
         typename std::set<TermType>::const_iterator prev_it = data.begin();
         if(is_negligible(*prev_it, data.size() + 1)) return false;
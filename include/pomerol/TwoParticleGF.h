@@ -82,6 +82,14 @@ protected:
      */
     BlockNumber getRightIndex(size_t PermutationNumber, size_t OperatorPosition, BlockNumber LeftIndex) const; //!< return right index of an operator at current position for a current permutation
 
+    /** Computes the parts and fills values at either a block or a grid of frequencies.
+     * \param[in] clear Purge the terms of the parts after filling the values.
+     * \param[in] Freqs A block of frequencies (may be NULL).
+     * \param[in] Grid A grid of frequencies (may be NULL).
+     * \param[in] comm MPI communicator.
+     */
+    std::vector<ComplexType> computeParts(bool clear, const FrequencyBlock* Freqs, const FrequencyGrid* Grid, const boost::mpi::communicator & comm);
+
 public:
     /** A difference in energies with magnitude less than this value is treated as zero. default = 1e-8. */
     RealType ReduceResonanceTolerance;
@@ -89,6 +97,14 @@ public:
     RealType CoefficientTolerance;
     /** Minimal magnitude of the coefficient of a term to take it into account with respect to amount of terms. default = 1e-5. */
     RealType MultiTermCoefficientTolerance;
+    /** Storage layout of the lists of terms in the parts. default = TreeStorage. */
+    TermStorage TermsStorage;
+    /** Compute every part with multiple OpenMP threads (useful when a few parts dominate). default = false. */
+    bool ThreadedCompute;
+    /** Keep the terms of every part only on the process, which has computed it, instead of broadcasting
+     * them to all processes (when compute() is called with clear = false).
+     * The values are then obtained with the collective versions of evaluate(). default = false. */
+    bool DistributedTerms;
 
     /** Constructor.
      * \param[in] S A reference to a states classification object.
@@ -117,6 +133,13 @@ public:
         std::vector<boost::tuple<ComplexType, ComplexType, ComplexType> > const& freqs  = std::vector<boost::tuple<ComplexType, ComplexType, ComplexType> >(),
         const boost::mpi::communicator & comm = boost::mpi::communicator()
     );
+    /** Actually computes the parts and returns the values on a grid of Matsubara frequencies.
+     * \param[in] clear Purge the terms of the parts after filling the values.
+     * \param[in] Grid A grid of Matsubara frequencies.
+     * \param[in] comm MPI communicator.
+     */
+    std::vector<ComplexType> compute(bool clear, const FrequencyGrid& Grid,
+        const boost::mpi::communicator & comm = boost::mpi::communicator());
 
     /** Returns the 'bit' (index) of one of operators C1, C2, CX3 or CX4.
      * \param[in] Position Zero-based number of the operator to use.
@@ -136,6 +159,33 @@ public:
      */
     ComplexType operator()(long MatsubaraNumber1, long MatsubaraNumber2, long MatsubaraNumber3) const;
 
+    /** Calculates the values of the Green's function at a block of frequencies.
+     * All terms of a part are processed at once for a tile of frequencies.
+     * \param[in] Freqs A block of frequencies.
+     * \param[out] out Array of Freqs.size() values.
+     */
+    void evaluate(const FrequencyBlock& Freqs, ComplexType* out) const;
+    /** Calculates the values of the Green's function on a grid of Matsubara frequencies.
+     * \param[in] Grid A grid of Matsubara frequencies.
+     * \param[out] out Array of Grid.size() values.
+     */
+    void evaluate(const FrequencyGrid& Grid, ComplexType* out) const;
+    /** Calculates the values of the Green's function at a block of frequencies, when the terms are
+     * distributed over processes (see DistributedTerms). Every process evaluates the parts it holds,
+     * and the values are summed up on all processes. Must be called on all processes of comm.
+     * \param[in] Freqs A block of frequencies.
+     * \param[out] out Array of Freqs.size() values.
+     * \param[in] comm MPI communicator including all processes, which have computed the parts.
+     */
+    void evaluate(const FrequencyBlock& Freqs, ComplexType* out, const boost::mpi::communicator & comm) const;
+    /** Calculates the values of the Green's function on a grid of Matsubara frequencies, when the terms are
+     * distributed over processes (see DistributedTerms). Must be called on all processes of comm.
+     * \param[in] Grid A grid of Matsubara frequencies.
+     * \param[out] out Array of Grid.size() values.
+     * \param[in] comm MPI communicator including all processes, which have computed the parts.
+     */
+    void evaluate(const FrequencyGrid& Grid, ComplexType* out, const boost::mpi::communicator & comm) const;
+
     //void fillContainer(MatsubaraContainer& d, const std::vector<TwoParticleGFPart::NonResonantTerm>& NonResonantTerms, const std::vector<TwoParticleGFPart::ResonantTerm>& ResonantTerms, Permutation3 Permutation);
 
     /** Returns true, if GF is identical to zero */
@@ -40,7 +40,12 @@ public:
     RealType CoefficientTolerance;
     /** Minimal magnitude of the coefficient of a term to take it into account with respect to amount of terms. default = 1e-5. */
     RealType MultiTermCoefficientTolerance;
-
+    /** Storage layout of the lists of terms in the parts. default = TreeStorage. */
+    TermStorage TermsStorage;
+    /** Compute every part with multiple OpenMP threads (useful when a few parts dominate). default = false. */
+    bool ThreadedCompute;
+    /** Keep the terms of every part only on the process, which has computed it (see TwoParticleGF::DistributedTerms). default = false. */
+    bool DistributedTerms;
 
     TwoParticleGFContainer(const IndexClassification& IndexInfo, const StatesClassification &S,
                            const Hamiltonian &H, const DensityMatrix &DM, const FieldOperatorContainer& Operators);
@@ -16,6 +16,60 @@
 
 namespace Pomerol{
 
+/** A rectangular grid of Matsubara frequency triplets
+ * \f$ (z_1,z_2,z_3) = (\Omega_m+\omega_{n_3}, \omega_{n_2}, \omega_{n_3}) \f$,
+ * where \f$ \Omega_m = 2\pi m/\beta \f$ is a bosonic and \f$ \omega_n = \pi(2n+1)/\beta \f$
+ * is a fermionic Matsubara frequency. The triplets are ordered with \f$ m \f$ as the slowest
+ * and \f$ n_2 \f$ as the fastest running index.
+ */
+struct FrequencyGrid {
+    /** The lowest and the highest bosonic index \f$ m \f$. */
+    long BosonicMin, BosonicMax;
+    /** The lowest and the highest fermionic index \f$ n_2 \f$ (\f$ n_3 \f$). */
+    long FermionicMin, FermionicMax;
+
+    /** Constructor.
+     * \param[in] BosonicMin The lowest bosonic index.
+     * \param[in] BosonicMax The highest bosonic index.
+     * \param[in] FermionicMin The lowest fermionic index.
+     * \param[in] FermionicMax The highest fermionic index.
+     */
+    FrequencyGrid(long BosonicMin, long BosonicMax, long FermionicMin, long FermionicMax) :
+        BosonicMin(BosonicMin), BosonicMax(BosonicMax), FermionicMin(FermionicMin), FermionicMax(FermionicMax) {}
+
+    /** Returns the number of bosonic frequencies. */
+    long getBosonicSize() const { return BosonicMax - BosonicMin + 1; }
+    /** Returns the number of fermionic frequencies. */
+    long getFermionicSize() const { return FermionicMax - FermionicMin + 1; }
+    /** Returns the number of frequency triplets in the grid. */
+    long size() const { return getBosonicSize()*getFermionicSize()*getFermionicSize(); }
+};
+
+/** A block of frequency triplets \f$ (z_1,z_2,z_3) \f$ stored as a structure of arrays. */
+struct FrequencyBlock {
+    /** Frequencies \f$ z_1 \f$. */
+    ComplexVectorType z1;
+    /** Frequencies \f$ z_2 \f$. */
+    ComplexVectorType z2;
+    /** Frequencies \f$ z_3 \f$. */
+    ComplexVectorType z3;
+
+    /** Constructor of an empty block. */
+    FrequencyBlock() {}
+    /** Constructor.
+     * \param[in] freqs A list of frequency triplets.
+     */
+    FrequencyBlock(const std::vector<boost::tuple<ComplexType, ComplexType, ComplexType> >& freqs);
+    /** Constructor.
+     * \param[in] Grid A grid of Matsubara frequencies.
+     * \param[in] beta The inverse temperature.
+     */
+    FrequencyBlock(const FrequencyGrid& Grid, RealType beta);
+
+    /** Returns the number of frequency triplets in the block. */
+    long size() const { return z1.size(); }
+};
+
 /** This class represents a part of a two-particle Green's function.
  * Every part describes one 'world stripe' of four operators.
  */
@@ -239,6 +293,82 @@ private:
     /** A list of resonant terms. */
     TermList<ResonantTerm> ResonantTerms;
 
+    /** Non-resonant terms stored as a structure of arrays for fast evaluation.
+     * The middle pole is \f$ P_2 \f$ if isz4 == false and \f$ P_1+P_2+P_3 \f$ otherwise.
+     */
+    struct NonResonantArrays {
+        /** Real and imaginary parts of the coefficients. */
+        RealVectorType CoeffRe, CoeffIm;
+        /** Poles \f$ P_1 \f$, middle poles and poles \f$ P_3 \f$. */
+        RealVectorType P1, PMid, P3;
+        /** Resizes all arrays. */
+        void resize(long Size);
+    };
+
+    /** Resonant terms stored as a structure of arrays for fast evaluation.
+     * The middle pole is \f$ P_1+P_2 \f$ if isz1z2 == true and \f$ P_2+P_3 \f$ otherwise.
+     */
+    struct ResonantArrays {
+        /** Real and imaginary parts of the coefficients \f$ R \f$. */
+        RealVectorType ResCoeffRe, ResCoeffIm;
+        /** Real and imaginary parts of the coefficients \f$ N \f$. */
+        RealVectorType NonResCoeffRe, NonResCoeffIm;
+        /** Poles \f$ P_1 \f$, middle poles and poles \f$ P_3 \f$. */
+        RealVectorType P1, PMid, P3;
+        /** Resizes all arrays. */
+        void resize(long Size);
+    };
+
+    /** Frozen non-resonant terms, indexed by isz4. */
+    NonResonantArrays FrozenNonResonantTerms[2];
+    /** Frozen resonant terms, indexed by isz1z2. */
+    ResonantArrays FrozenResonantTerms[2];
+    /** Are the frozen arrays in use? */
+    bool Frozen;
+
+    /** Returns a sum of frozen non-resonant terms.
+     * \param[in] Terms Frozen terms.
+     * \param[in] z1 Frequency \f$ z_1 \f$.
+     * \param[in] zMid Frequency \f$ z_2 \f$ or \f$ z_1+z_2+z_3 \f$.
+     * \param[in] z3 Frequency \f$ z_3 \f$.
+     */
+    static ComplexType sumTerms(const NonResonantArrays& Terms, ComplexType z1, ComplexType zMid, ComplexType z3);
+    /** Returns a sum of frozen resonant terms.
+     * \param[in] Terms Frozen terms.
+     * \param[in] z1 Frequency \f$ z_1 \f$.
+     * \param[in] zMid Frequency \f$ z_1+z_2 \f$ or \f$ z_2+z_3 \f$.
+     * \param[in] z3 Frequency \f$ z_3 \f$.
+     * \param[in] KroneckerSymbolTolerance Tolerance of the resonance condition.
+     */
+    static ComplexType sumTerms(const ResonantArrays& Terms, ComplexType z1, ComplexType zMid, ComplexType z3, RealType KroneckerSymbolTolerance);
+    /** Copies the terms into arrays.
+     * \param[out] NonResonant Arrays of non-resonant terms, indexed by isz4.
+     * \param[out] Resonant Arrays of resonant terms, indexed by isz1z2.
+     */
+    void fillArrays(NonResonantArrays* NonResonant, ResonantArrays* Resonant) const;
+    /** Releases memory occupied by the frozen arrays. */
+    void unfreeze();
+
+    /** Number of frequencies in a tile processed by evaluate(). */
+    static const long FrequencyTileSize = 64;
+    /** Adds contributions of non-resonant terms to a tile of frequencies.
+     * \param[in] Terms Frozen terms.
+     * \param[in] TileLength Number of frequencies in the tile.
+     * \param[in] Tile Real and imaginary parts of \f$ z_1 \f$, \f$ z_{mid} \f$ and \f$ z_3 \f$.
+     * \param[in,out] Re Real parts of the result.
+     * \param[in,out] Im Imaginary parts of the result.
+     */
+    static void addTerms(const NonResonantArrays& Terms, long TileLength, const RealType (*Tile)[FrequencyTileSize], RealType* Re, RealType* Im);
+    /** Adds contributions of resonant terms to a tile of frequencies.
+     * \param[in] Terms Frozen terms.
+     * \param[in] TileLength Number of frequencies in the tile.
+     * \param[in] Tile Real and imaginary parts of \f$ z_1 \f$, \f$ z_{mid} \f$ and \f$ z_3 \f$.
+     * \param[in] KroneckerSymbolTolerance Tolerance of the resonance condition.
+     * \param[in,out] Re Real parts of the result.
+     * \param[in,out] Im Imaginary parts of the result.
+     */
+    static void addTerms(const ResonantArrays& Terms, long TileLength, const RealType (*Tile)[FrequencyTileSize], RealType KroneckerSymbolTolerance, RealType* Re, RealType* Im);
+
     /** Adds a multi-term that has the following form:
     * \f[
     * \frac{1}{(z_1-P_1)(z_3-P_3)}
@@ -280,10 +410,24 @@ private:
     * \param[in] Wk The third weight \f$ w_k \f$.
     * \param[in] Wl The fourth weight \f$ w_l \f$.
     * \param[in] Permutation A reference to a permutation of operators for this part.
+    * \param[in,out] NonResonant A list to add the non-resonant terms to.
+    * \param[in,out] Resonant A list to add the resonant terms to.
     */
     void addMultiterm(ComplexType Coeff, RealType beta,
                       RealType Ei, RealType Ej, RealType Ek, RealType El,
-                      RealType Wi, RealType Wj, RealType Wk, RealType Wl);
+                      RealType Wi, RealType Wj, RealType Wk, RealType Wl,
+                      TermList<NonResonantTerm>& NonResonant, TermList<ResonantTerm>& Resonant) const;
+
+    /** Adds all terms with a given outer index \f$ |1\rangle \f$ to the lists.
+     * \param[in] index1 The outer index.
+     * \param[in,out] NonResonant A list to add the non-resonant terms to.
+     * \param[in,out] Resonant A list to add the resonant terms to.
+     */
+    void computeTerms(InnerQuantumState index1,
+                      TermList<NonResonantTerm>& NonResonant, TermList<ResonantTerm>& Resonant) const;
+
+    /** Distribute the outer loop of compute() over OpenMP threads. default = false. */
+    bool ThreadedCompute;
 
     /** A difference in energies with magnitude less than this value is treated as zero. default = 1e-8. */
     RealType ReduceResonanceTolerance;
@@ -322,6 +466,28 @@ public:
     /** Purges all terms. */
     void clear();
 
+    /** Copies the computed terms into contiguous arrays, which are then used by operator()
+     * instead of the lists of terms. The arrays are released by compute() and clear().
+     */
+    void freeze();
+    /** Returns true if the frozen arrays are in use. */
+    bool isFrozen() const;
+
+    /** Adds the values of this part at a block of frequencies to an output array.
+     * Frequencies are processed in tiles, every term is loaded once per tile.
+     * \param[in] Freqs A block of frequencies.
+     * \param[in,out] out Array of Freqs.size() values to add to.
+     */
+    void evaluate(const FrequencyBlock& Freqs, ComplexType* out) const;
+    /** Adds the values of this part on a grid of Matsubara frequencies to an output array.
+     * Every term is a product of three factors, each of them depending on a single Matsubara
+     * number. For every bosonic frequency the factors are tabulated once per term,
+     * so that the values on the grid are assembled without complex divisions.
+     * \param[in] Grid A grid of Matsubara frequencies.
+     * \param[in,out] out Array of Grid.size() values to add to.
+     */
+    void evaluate(const FrequencyGrid& Grid, ComplexType* out) const;
+
     /** Returns the value of the Green's function calculated at a given frequency (ignores precomputed values).
     * \param[in] z1 Frequency 1
     * \param[in] z2 Frequency 2
@@ -343,12 +509,62 @@ public:
     /** Returns a Permutation3 of the current part */
     const Permutation3& getPermutation() const;
 
+    /** Returns an estimate of the cost of compute(): the number of visited pairs of outer indices
+     * plus the expected number of multiterms, derived from the numbers of non-zero elements
+     * of the four operator parts.
+     */
+    RealType getComplexity() const;
+
     /** Return the list of Resonant Terms */
     const TermList<TwoParticleGFPart::ResonantTerm>& getResonantTerms() const;
     /** Return the list of NonResonantTerms */
     const TermList<TwoParticleGFPart::NonResonantTerm>& getNonResonantTerms() const;
 };
 
+//
+// TwoParticleGFPart::NonResonantTerm
+//
+inline
+TwoParticleGFPart::NonResonantTerm::NonResonantTerm(ComplexType Coeff, RealType P1, RealType P2, RealType P3, bool isz4) :
+Coeff(Coeff), isz4(isz4)
+{
+    Poles[0] = P1; Poles[1] = P2; Poles[2] = P3; Weight=1;
+}
+
+inline
+TwoParticleGFPart::NonResonantTerm& TwoParticleGFPart::NonResonantTerm::operator+=(
+                    const NonResonantTerm& AnotherTerm)
+{
+    long combinedWeight=Weight + AnotherTerm.Weight;
+    for (unsigned short p=0; p<3; ++p) Poles[p]= (Weight*Poles[p] + AnotherTerm.Weight*AnotherTerm.Poles[p])/combinedWeight;
+    Weight=combinedWeight;
+    Coeff += AnotherTerm.Coeff;
+    return *this;
+}
+
+//
+// TwoParticleGFPart::ResonantTerm
+//
+inline
+TwoParticleGFPart::ResonantTerm::ResonantTerm(ComplexType ResCoeff, ComplexType NonResCoeff,
+                                              RealType P1, RealType P2, RealType P3, bool isz1z2):
+ResCoeff(ResCoeff), NonResCoeff(NonResCoeff), isz1z2(isz1z2)
+{
+    Poles[0] = P1; Poles[1] = P2; Poles[2] = P3; Weight=1;
+}
+
+inline
+TwoParticleGFPart::ResonantTerm& TwoParticleGFPart::ResonantTerm::operator+=(
+                const ResonantTerm& AnotherTerm)
+{
+    long combinedWeight=Weight + AnotherTerm.Weight;
+    for (unsigned short p=0; p<3; ++p) Poles[p]= (Weight*Poles[p] + AnotherTerm.Weight*AnotherTerm.Poles[p])/combinedWeight;
+    Weight=combinedWeight;
+    ResCoeff += AnotherTerm.ResCoeff;
+    NonResCoeff += AnotherTerm.NonResCoeff;
+    return *this;
+}
+
 inline
 ComplexType TwoParticleGFPart::NonResonantTerm::operator()(ComplexType z1, ComplexType z2, ComplexType z3) const
 {
@@ -249,7 +249,7 @@ int main(int argc, char* argv[])
         GFContainer G(IndexInfo,S,H,rho,Operators);
 
         G.prepareAll(indices2); // identify all non-vanishing block connections in the Green's function
-        G.computeAll(); // Evaluate all GF terms, i.e. resonances and weights of expressions in Lehmans representation of the Green's function
+        G.computeAll(comm); // Evaluate all GF terms, i.e. resonances and weights of expressions in Lehmans representation of the Green's function
 
         if (!comm.rank()) // dump gf into a file
         // loops over all components (pairs of indices) of the Green's function
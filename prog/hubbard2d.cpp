@@ -223,7 +223,7 @@ int main(int argc, char* argv[])
         GFContainer G(IndexInfo,S,H,rho,Operators);
 
         G.prepareAll(indices2); // identify all non-vanishing block connections in the Green's function
-        G.computeAll(); // Evaluate all GF terms, i.e. resonances and weights of expressions in Lehmans representation of the Green's function
+        G.computeAll(comm); // Evaluate all GF terms, i.e. resonances and weights of expressions in Lehmans representation of the Green's function
 
         if (!comm.rank()) // dump gf into a file
         for (auto ind2 : indices2) { // loops over all components (pairs of indices) of the Green's function
@@ -231,8 +231,11 @@ int main(int argc, char* argv[])
             std::cout << "Saving imfreq G" << ind2 << " on "<< 4*wf_max << " Matsubara freqs. " << std::endl;
             std::ofstream gw_im("gw_imag"+std::to_string(ind2.Index1)+std::to_string(ind2.Index2)+".dat");
             const GreensFunction & GF = G(ind2);
+            ComplexVectorType grid_im(wf_max*4), gw_im_values;
+            for (int wn = 0; wn < wf_max*4; wn++) grid_im(wn) = I*FMatsubara(wn,beta);
+            GF.evaluate(grid_im, gw_im_values); // this comes from Pomerol - see GreensFunction::evaluate()
             for (int wn = 0; wn < wf_max*4; wn++) {
-                ComplexType val = GF(I*FMatsubara(wn,beta)); // this comes from Pomerol - see GreensFunction::operator()
+                ComplexType val = gw_im_values(wn);
                 gw_im << std::scientific << std::setprecision(12) << FMatsubara(wn,beta) << "   " << real(val) << " " << imag(val) << std::endl;
             };
             gw_im.close();
@@ -240,9 +243,14 @@ int main(int argc, char* argv[])
             double e0 = U - 2.*mu;
             std::ofstream gw_re("gw_real"+std::to_string(ind2.Index1)+std::to_string(ind2.Index2)+".dat");
             std::cout << "Saving real-freq GF " << ind2 << " in energy space [" << e0-hbw << ":" << e0+hbw << ":" << step << "] + I*" << eta << "." << std::endl;
-            for (double w = e0-hbw; w < e0+hbw; w+=step) {
-                ComplexType val = GF(ComplexType(w) + I*eta);
-                gw_re << std::scientific << std::setprecision(12) << w << "   " << real(val) << " " << imag(val) << std::endl;
+            std::vector<double> w_grid;
+            for (double w = e0-hbw; w < e0+hbw; w+=step) w_grid.push_back(w);
+            ComplexVectorType grid_re(w_grid.size()), gw_re_values;
+            for (size_t n = 0; n < w_grid.size(); n++) grid_re(n) = ComplexType(w_grid[n]) + I*eta;
+            GF.evaluate(grid_re, gw_re_values);
+            for (size_t n = 0; n < w_grid.size(); n++) {
+                ComplexType val = gw_re_values(n);
+                gw_re << std::scientific << std::setprecision(12) << w_grid[n] << "   " << real(val) << " " << imag(val) << std::endl;
             };
             gw_re.close();
         }
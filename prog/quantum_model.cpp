@@ -176,24 +176,16 @@ void quantum_model::compute() {
           }
         }
       }
-#else
-      // Fill a vector of tuples of fermionic Matsubara frequencies - these will be evaluated in-place
-      std::vector< boost::tuples::tuple<ComplexType, ComplexType, ComplexType> > freqs_2pgf;
-      for (int W_index = -wb_min; W_index <= wb_max; W_index++) { // loop over bosonic freq
-        ComplexType W = I*BMatsubara(W_index, beta);
-        for (int w3_index = -wf_max; w3_index<=wf_max; w3_index++) { // loop over first fermionic frequency
-          ComplexType w3 = I*FMatsubara(w3_index, beta);
-          for (int w2_index = -wf_max; w2_index<=wf_max; w2_index++) { // loop over second fermionic
-            ComplexType w2 = I*FMatsubara(w2_index, beta);
-            ComplexType w1 = W+w3;
-            freqs_2pgf.push_back(boost::tuples::make_tuple(w1, w2, w3));
-          }
-        }
-      }
-#endif
       mpi_cout << "2PGF : " << freqs_2pgf.size() << " freqs to evaluate" << std::endl;
 
       std::vector<ComplexType> chi_freq_data = G4.compute(true, freqs_2pgf, comm); // mdata[ind];
+#else
+      // A grid of Matsubara frequencies (W+w3, w2, w3) - W runs over [-wb_min, wb_max], w3 and w2 over [-wf_max, wf_max]
+      FrequencyGrid grid_2pgf(-wb_min, wb_max, -wf_max, wf_max);
+      mpi_cout << "2PGF : " << grid_2pgf.size() << " freqs to evaluate" << std::endl;
+
+      std::vector<ComplexType> chi_freq_data = G4.compute(true, grid_2pgf, comm); // mdata[ind];
+#endif
 
 #ifdef POMEROL_CXX11
       // dump 2PGF into files - loop through 2pgf components
@@ -237,8 +229,6 @@ void quantum_model::compute() {
             ComplexType w3 = I*FMatsubara(w3_index, beta);
             for (int w2_index = -wf_max; w2_index<=wf_max; w2_index++) { // loop over second fermionic
               ComplexType w2 = I*FMatsubara(w2_index, beta);
-              ComplexType w1 = W+w3;
-              if (::std::abs(w1 - boost::tuples::get<0>(freqs_2pgf[w])) > 1e-8) throw std::logic_error("2pgf freq mismatch");
 
               std::complex<double> val = chi_freq_data[w];
 
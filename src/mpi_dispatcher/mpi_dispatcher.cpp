@@ -1,5 +1,7 @@
 #include "mpi_dispatcher/mpi_dispatcher.hpp"
 #include <numeric>
+#include <algorithm>
+#include <time.h>
 
 namespace pMPI {
 
@@ -162,5 +164,112 @@ void MPIMaster::check_workers()
     }
 }
 
+//
+// Work-stealing worker
+//
+
+MPIStealingWorker::MPIStealingWorker(const boost::mpi::communicator &comm, const std::vector<JobId>& task_numbers):
+    Comm(comm),
+    id(Comm.rank()),
+    current_job_(-1),
+    victim_((Comm.rank()+1) % Comm.size()),
+    NDone(0)
+{
+    // Jobs are dealt cyclically, so that every process gets a share of both expensive and cheap jobs
+    for (size_t i=id; i<task_numbers.size(); i+=Comm.size()) JobQueue.push_back(task_numbers[i]);
+}
+
+bool MPIStealingWorker::serve_requests_()
+{
+    bool served = false;
+    // A probe for a given tag may miss the messages, which have arrived during a job, until the MPI library
+    // has progressed its incoming queue. Let it do so first, so that the requests are not left to the next job.
+    Comm.iprobe(boost::mpi::any_source, boost::mpi::any_tag);
+    while (boost::optional<boost::mpi::status> st = Comm.iprobe(boost::mpi::any_source, int(pMPI::StealRequest))) {
+        WorkerId thief = st->source();
+        Comm.recv(thief, int(pMPI::StealRequest));
+        // Give away the cheaper half of the queue
+        std::vector<JobId> loot(JobQueue.end() - JobQueue.size()/2, JobQueue.end());
+        JobQueue.erase(JobQueue.end() - loot.size(), JobQueue.end());
+        Comm.send(thief, int(pMPI::StealReply), loot);
+        served = true;
+    }
+    while (boost::optional<boost::mpi::status> st = Comm.iprobe(boost::mpi::any_source, int(pMPI::Done))) {
+        Comm.recv(st->source(), int(pMPI::Done));
+        ++NDone;
+        served = true;
+    }
+    return served;
+}
+
+void MPIStealingWorker::idle_wait_(long& wait_us)
+{
+    // Serve the pending messages, or sleep to leave the core to the threads of other jobs
+    if (serve_requests_()) { wait_us = min_wait_us(); return; }
+    timespec t;
+    t.tv_sec = wait_us / 1000000;
+    t.tv_nsec = (wait_us % 1000000) * 1000;
+    nanosleep(&t, NULL);
+    wait_us = std::min(2*wait_us, max_wait_us());
+}
+
+bool MPIStealingWorker::steal_()
+{
+    for (int i=0; i<Comm.size(); i++) {
+        WorkerId victim = (victim_ + i) % Comm.size();
+        if (victim == id) continue;
+        std::vector<JobId> loot;
+        boost::mpi::request send_req = Comm.isend(victim, int(pMPI::StealRequest));
+        boost::mpi::request req = Comm.irecv(victim, int(pMPI::StealReply), loot);
+        // The victim replies between its jobs only. Other thieves may be waiting for this process meanwhile.
+        long wait_us = min_wait_us();
+        while (!req.test()) idle_wait_(wait_us);
+        send_req.wait();
+        if (!loot.empty()) {
+            JobQueue.insert(JobQueue.end(), loot.begin(), loot.end());
+            victim_ = victim; // ask the same process first next time
+            return true;
+        }
+    }
+    return false;
+}
+
+bool MPIStealingWorker::next_job()
+{
+    serve_requests_();
+    if (JobQueue.empty() && !steal_()) {
+        // No jobs left anywhere for this process. Keep answering requests until all processes are out of jobs.
+        // A process sends Done only after all of its requests have been answered, so none are left behind.
+        std::vector<boost::mpi::request> done_reqs;
+        for (int p=0; p<Comm.size(); p++) {
+            if (p != id) done_reqs.push_back(Comm.isend(p, int(pMPI::Done)));
+        }
+        long wait_us = min_wait_us();
+        while (NDone < Comm.size()-1) idle_wait_(wait_us);
+        boost::mpi::wait_all(done_reqs.begin(), done_reqs.end());
+        current_job_ = -1;
+        return false;
+    }
+    current_job_ = JobQueue.front();
+    JobQueue.pop_front();
+    return true;
+}
+
+void MPIStealingWorker::report_job_done()
+{
+    DoneJobs.push_back(current_job_);
+}
+
+std::map<JobId, WorkerId> MPIStealingWorker::dispatch_map() const
+{
+    std::vector<std::vector<JobId> > jobs;
+    boost::mpi::all_gather(Comm, DoneJobs, jobs);
+    std::map<JobId, WorkerId> out;
+    for (size_t p=0; p<jobs.size(); p++) {
+        for (size_t i=0; i<jobs[p].size(); i++) out[jobs[p][i]] = p;
+    }
+    return out;
+}
+
 } // end of namespace MPI
 
@@ -106,7 +106,7 @@ void DensityMatrix::truncateBlocks(RealType Tolerance, bool verbose)
         for(BlockNumber i=0; i<S.NumberOfBlocks(); i++)
             if(isRetained(i)){
                 ++n_blocks_retained;
-                n_states_retained += S.getBlockSize(i);
+                n_states_retained += H.getPart(i).getEigenValues().size(); // only the lowest states of a sparse part
             }
         INFO("Number of blocks retained: " << n_blocks_retained);
         INFO("Number of states retained: " << n_states_retained);
@@ -8,6 +8,7 @@ DensityMatrixPart::DensityMatrixPart(const StatesClassification &S, const Hamilt
 RealType DensityMatrixPart::computeUnnormalized(void)
 {
     Z_part = 0;
+    weights.resize(hpart.getEigenValues().size()); // A sparse part may have less eigenvalues than states
     QuantumState partSize = weights.size();
     for(InnerQuantumState s = 0; s < partSize; ++s){
         // The non-normalized weight is <=1 for any state.
@@ -0,0 +1,67 @@
+#include "pomerol/EigenSolver.h"
+#include <stdexcept>
+
+#ifdef POMEROL_USE_LAPACK
+extern "C" {
+void dsyevd_(const char* jobz, const char* uplo, const int* n, double* a, const int* lda, double* w,
+             double* work, const int* lwork, int* iwork, const int* liwork, int* info);
+void zheevd_(const char* jobz, const char* uplo, const int* n, std::complex<double>* a, const int* lda, double* w,
+             std::complex<double>* work, const int* lwork, double* rwork, const int* lrwork,
+             int* iwork, const int* liwork, int* info);
+}
+#else
+#include <Eigen/Eigenvalues>
+#endif
+
+namespace Pomerol{
+
+#ifdef POMEROL_USE_LAPACK
+
+const char* getEigenSolverName() { return "LAPACK"; }
+
+void diagonalize(MatrixType& H, RealVectorType& Eigenvalues)
+{
+    // LAPACK sees the row-major H as its transpose, i.e. as the complex conjugate of H.
+    // The eigenvectors of H are then obtained by an adjoint of the output.
+    int n = H.rows(), info = 0, query = -1;
+    Eigenvalues.resize(n);
+    if (n == 0) return;
+    int liwork;
+    #ifdef POMEROL_COMPLEX_MATRIX_ELEMENTS
+    ComplexType lwork_opt;
+    double lrwork_opt;
+    zheevd_("V", "U", &n, H.data(), &n, Eigenvalues.data(), &lwork_opt, &query, &lrwork_opt, &query, &liwork, &query, &info);
+    int lwork = int(std::real(lwork_opt)), lrwork = int(lrwork_opt);
+    std::vector<ComplexType> work(lwork);
+    std::vector<double> rwork(lrwork);
+    std::vector<int> iwork(liwork);
+    zheevd_("V", "U", &n, H.data(), &n, Eigenvalues.data(), &work[0], &lwork, &rwork[0], &lrwork, &iwork[0], &liwork, &info);
+    #else
+    double lwork_opt;
+    dsyevd_("V", "U", &n, H.data(), &n, Eigenvalues.data(), &lwork_opt, &query, &liwork, &query, &info);
+    int lwork = int(lwork_opt);
+    std::vector<double> work(lwork);
+    std::vector<int> iwork(liwork);
+    dsyevd_("V", "U", &n, H.data(), &n, Eigenvalues.data(), &work[0], &lwork, &iwork[0], &liwork, &info);
+    #endif
+    if (info != 0) {
+        ERROR("LAPACK eigensolver failed with info = " << info);
+        throw (std::runtime_error("Diagonalization failed."));
+        };
+    H.adjointInPlace();
+}
+
+#else
+
+const char* getEigenSolverName() { return "Eigen"; }
+
+void diagonalize(MatrixType& H, RealVectorType& Eigenvalues)
+{
+    Eigen::SelfAdjointEigenSolver<MatrixType> Solver(H,Eigen::ComputeEigenvectors);
+    H = Solver.eigenvectors();
+    Eigenvalues = Solver.eigenvalues();
+}
+
+#endif
+
+} // end of namespace Pomerol
@@ -2,6 +2,7 @@
 
 #include <boost/serialization/complex.hpp>
 #include <boost/serialization/vector.hpp>
+#include "pomerol/MatrixExchange.h"
 #include "mpi_dispatcher/mpi_skel.hpp"
 
 namespace Pomerol{
@@ -62,42 +63,44 @@ void FieldOperator::compute(const boost::mpi::communicator& comm)
     if (Status >= Computed) return;
 
     if (!comm.rank()) INFO_NONEWLINE("Computing " << *O << " in eigenbasis of the Hamiltonian: ");
-/*
 
-    pMPI::mpi_skel<pMPI::ComputeWrap<FieldOperatorPart>> skel;
-    skel.parts.resize(parts.size());
-    for (size_t i=0; i<parts.size(); i++) { skel.parts[i] = pMPI::ComputeWrap<FieldOperatorPart>(*parts[i]);};
-    std::map<pMPI::JobId, pMPI::WorkerId> job_map = skel.run(comm, true); // actual running - very costly
+    if (comm.size() == 1) {
+        // A single process computes all parts with its threads
+        #ifdef POMEROL_USE_OPENMP
+        #pragma omp parallel for schedule(dynamic)
+        #endif
+        for (long p = 0; p < long(parts.size()); p++) parts[p]->compute();
+        INFO("");
+        Status = Computed;
+        return;
+    }
 
-    int rank = comm.rank();
-    int comm_size = comm.size(); 
+    // The cost of a part is dominated by the product of a (left x right) and a (right x right) matrix
+    pMPI::mpi_skel<pMPI::ComputeWrap<FieldOperatorPart> > skel;
+    skel.parts.resize(parts.size());
+    for (size_t i=0; i<parts.size(); i++) {
+        RealType LeftSize = parts[i]->HTo.getSize(), RightSize = parts[i]->HFrom.getSize();
+        skel.parts[i] = pMPI::ComputeWrap<FieldOperatorPart>(*parts[i], LeftSize*RightSize*RightSize);
+        };
+    std::map<pMPI::JobId, pMPI::WorkerId> job_map = skel.run(comm, false);
 
     // Start distributing data
-    comm.barrier();
-         
+    int rank = comm.rank();
+    MatrixExchange exchange(comm);
     for (size_t p = 0; p<parts.size(); p++) {
-
-        int nelem = 0;
-        if (rank == job_map[p]) nelem = parts[p]->elementsColMajor.nonZeros(); 
-        boost::mpi::broadcast(comm, nelem, job_map[p]);
-        auto data = parts[p]->elementsColMajor.data(); // Eigen::internal::CompressedStorage 
-        auto& value_start = data.value(0);
-        auto& index_start = data.index(0);
-        if (comm.rank()) parts[p]->elementsColMajor.resize(nelem);
-        exit(0);
-
-        //boost::mpi::broadcast(comm, parts[p]->elementsColMajor.data(), nelem, job_map[p]);
-        if (rank == job_map[p]) { 
-                parts[p]->Status = FieldOperatorPart::Computed;
-             };
+        if (rank == job_map[p] && parts[p]->Status != FieldOperatorPart::Computed) {
+            ERROR ("Worker" << rank << " didn't calculate part" << p);
+            throw (std::logic_error("Worker didn't calculate this part."));
+            };
+        exchange.add(parts[p]->elementsRowMajor, job_map[p]);
+        };
+    exchange.run();
+    for (size_t p = 0; p<parts.size(); p++) {
+        if (rank != job_map[p]) {
+            parts[p]->elementsColMajor = parts[p]->elementsRowMajor;
+            parts[p]->Status = FieldOperatorPart::Computed;
+            };
         };
-    comm.barrier();
-*/
-    size_t Size = parts.size();
-    for (size_t BlockIn = 0; BlockIn < Size; BlockIn++){
-        INFO_NONEWLINE( (int) ((1.0*BlockIn/Size) * 100 ) << "  " << std::flush);
-        parts[BlockIn]->compute();
-    };
     INFO("");
     Status = Computed;
 }
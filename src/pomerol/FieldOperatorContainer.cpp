@@ -21,11 +21,11 @@ void FieldOperatorContainer::prepareAll(std::set<ParticleIndex> in)
         }
 }
 
-void FieldOperatorContainer::computeAll()
+void FieldOperatorContainer::computeAll(const boost::mpi::communicator& comm)
 {
     for (std::map <ParticleIndex, CreationOperator*>::iterator cdag_it = mapCreationOperators.begin(); cdag_it != mapCreationOperators.end(); ++cdag_it) {
         CreationOperator &cdag = *(cdag_it->second);
-        cdag.compute();
+        cdag.compute(comm);
         AnnihilationOperator &c = *mapAnnihilationOperators[cdag_it->first];
 
         FieldOperator::BlocksBimap cdag_block_map = cdag.getBlockMapping();
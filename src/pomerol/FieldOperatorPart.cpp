@@ -10,55 +10,67 @@ FieldOperatorPart::FieldOperatorPart(
         MatrixElementTolerance(1e-8)
 {}
 
+namespace {
+/** Collects the rows of the eigenvectors, which are gathered by FieldOperatorPart::compute, and the signs
+ *  of the matrix elements emitted by CompiledOperator::actRight. */
+struct GatherRows {
+    const StatesClassification& S;
+    BlockNumber To;
+    InnerQuantumState FromRow;
+    std::vector<InnerQuantumState>& ToRows;
+    std::vector<InnerQuantumState>& FromRows;
+    std::vector<RealType>& Signs;
+    GatherRows(const StatesClassification& S, BlockNumber To, InnerQuantumState FromRow,
+               std::vector<InnerQuantumState>& ToRows, std::vector<InnerQuantumState>& FromRows, std::vector<RealType>& Signs) :
+        S(S), To(To), FromRow(FromRow), ToRows(ToRows), FromRows(FromRows), Signs(Signs) {};
+    void operator()(QuantumState bra, MelemType melem) {
+        ToRows.push_back(S.getInnerState(To, bra));
+        FromRows.push_back(FromRow);
+        #ifdef POMEROL_COMPLEX_MATRIX_ELEMENTS
+        Signs.push_back(std::real(melem));
+        #else
+        Signs.push_back(melem);
+        #endif
+    };
+};
+}
+
 void FieldOperatorPart::compute()
 {
     if ( Status >= Computed ) return;
-    BlockNumber to = HTo.getBlockNumber();
     BlockNumber from = HFrom.getBlockNumber();
+    BlockNumber to = HTo.getBlockNumber();
 
-    const std::vector<FockState>& toStates = S.getFockStates(to);
     const std::vector<FockState>& fromStates = S.getFockStates(from);
 
-    MatrixType RightMat(fromStates.size(), fromStates.size());
-    MatrixType LeftMat(toStates.size(), fromStates.size());
-    RightMat.setZero();
-    LeftMat.setZero();
-
     /* Rotation is done in the following way:
      * C_{nm} = \sum_{lk} U^{+}_{nl} C_{lk} U_{km} = \sum_{lk} U^{*}_{ln}O_{lk}U_{km},
      * where the actual sum starts from k state. Big letters denote global states, smaller - InnerQuantumStates.
-     * We use the fact each column of O_{lk} has only one nonzero elements.
+     * We use the fact each column of O_{lk} has only one nonzero element, so O_{lk} is a permutation with signs:
+     * the rows l of U_to and the rows k of U_from (multiplied by the sign) are gathered, and the result is
+     * a single product C = L^{+} R.
      * */
-    for (std::vector<FockState>::const_iterator CurrentState = fromStates.begin();
-                                                CurrentState < fromStates.end(); CurrentState++) {
-	    FockState K=*CurrentState;
-        std::map<FockState, MelemType> result1 = O->actRight(K);
-        if (result1.size()) {
-            FockState L=result1.begin()->first;
-            #ifdef POMEROL_COMPLEX_MATRIX_ELEMENTS
-            int sign = int(std::real(result1.begin()->second));
-            #else
-            int sign = result1.begin()->second;
-            #endif
-	        if ( L!=ERROR_FOCK_STATE && std::abs(sign)>std::numeric_limits<RealType>::epsilon() ) {
-		        InnerQuantumState l=S.getInnerState(L), k=S.getInnerState(K);
-
-                for (InnerQuantumState n=0; n<toStates.size(); n++) {
-#ifdef POMEROL_COMPLEX_MATRIX_ELEMENTS
-                    LeftMat(n,k) = std::conj(HTo.getMatrixElement(l,n));
-#else
-                    LeftMat(n,k) = HTo.getMatrixElement(l,n);
-#endif
-                }
-
-                for (InnerQuantumState m=0; m<fromStates.size(); m++) {
-                    RightMat(k,m) = RealType(sign) * HFrom.getMatrixElement(k,m);
-                }
-	        }
-        }
+    std::vector<InnerQuantumState> ToRows, FromRows;
+    std::vector<RealType> Signs;
+    ToRows.reserve(fromStates.size());
+    FromRows.reserve(fromStates.size());
+    Signs.reserve(fromStates.size());
+    CompiledOperator CO(*O);
+    for (InnerQuantumState k = 0; k < fromStates.size(); k++) {
+        GatherRows emit(S, to, k, ToRows, FromRows, Signs);
+        CO.actRight(fromStates[k].to_ulong(), emit);
+    }
+
+    const MatrixType& UTo = HTo.getMatrix();
+    const MatrixType& UFrom = HFrom.getMatrix();
+    MatrixType LeftMat(ToRows.size(), UTo.cols());
+    MatrixType RightMat(FromRows.size(), UFrom.cols());
+    for (size_t i=0; i<ToRows.size(); i++) {
+        LeftMat.row(i) = UTo.row(ToRows[i]);
+        RightMat.row(i) = Signs[i] * UFrom.row(FromRows[i]);
     }
 
-    elementsRowMajor = (LeftMat * RightMat).sparseView(MatrixElementTolerance);
+    elementsRowMajor = (LeftMat.adjoint() * RightMat).sparseView(MatrixElementTolerance);
     #ifndef POMEROL_COMPLEX_MATRIX_ELEMENTS
     elementsRowMajor.prune(MatrixElementTolerance);
     #endif
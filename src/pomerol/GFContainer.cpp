@@ -1,4 +1,6 @@
 #include "pomerol/GFContainer.h"
+#include "pomerol/MatrixExchange.h"
+#include "mpi_dispatcher/mpi_skel.hpp"
 
 namespace Pomerol{
 
@@ -10,19 +12,78 @@ GFContainer::GFContainer ( const IndexClassification& IndexInfo,
     Thermal(DM), S(S), H(H), DM(DM), Operators(Operators)
 {}
 
+void GFContainer::setPermutations(const std::vector<DynamicIndexCombination>& Permutations)
+{
+    this->Permutations = Permutations;
+}
+
+void GFContainer::mergeEquivalentElements()
+{
+    // Union-find over all pairs of indices, the classes are the orbits of the group generated by the permutations
+    ParticleIndex N = IndexInfo.getIndexSize();
+    std::vector<size_t> root(N*N);
+    for(size_t p = 0; p < root.size(); ++p) root[p] = p;
+    for(size_t n = 0; n < Permutations.size(); ++n)
+        for(ParticleIndex i = 0; i < N; ++i)
+            for(ParticleIndex j = 0; j < N; ++j){
+                size_t a = i*N + j, b = Permutations[n].getIndex(i)*N + Permutations[n].getIndex(j);
+                while(root[a] != a) a = root[a] = root[root[a]];
+                while(root[b] != b) b = root[b] = root[root[b]];
+                if(a != b) root[std::max(a,b)] = std::min(a,b);
+            }
+
+    // The first component of every class in the container is its representative
+    std::map<size_t,GFPointer> representatives;
+    for(std::map<IndexCombination2,GFPointer>::iterator iter = ElementsMap.begin();
+        iter != ElementsMap.end(); iter++){
+        size_t a = iter->first.Index1*N + iter->first.Index2;
+        while(root[a] != a) a = root[a];
+        std::map<size_t,GFPointer>::iterator rep = representatives.find(a);
+        if(rep == representatives.end()) representatives[a] = iter->second;
+        else iter->second = rep->second;
+    }
+    INFO("GFContainer: " << representatives.size() << " independent components out of " << ElementsMap.size());
+}
+
 void GFContainer::prepareAll(const std::set<IndexCombination2>& InitialIndices)
 {
     fill(InitialIndices);
+    if(Permutations.size()) mergeEquivalentElements();
     for(std::map<IndexCombination2,GFPointer>::iterator iter = ElementsMap.begin();
         iter != ElementsMap.end(); iter++)
         (iter->second)->prepare();
 }
 
-void GFContainer::computeAll()
+void GFContainer::computeAll(const boost::mpi::communicator& comm)
 {
+    // Every component is a job, its complexity is estimated from its parts as for the parts of a 2PGF.
+    // The components, which share an element, are computed once.
+    std::vector<GFPointer> elements;
+    std::set<GreensFunction*> added;
+    pMPI::mpi_skel<pMPI::ComputeWrap<GreensFunction> > skel;
     for(std::map<IndexCombination2,GFPointer>::iterator iter = ElementsMap.begin();
-        iter != ElementsMap.end(); iter++)
-        (iter->second)->compute();
+        iter != ElementsMap.end(); iter++) {
+        if(!added.insert(iter->second.get()).second) continue;
+        elements.push_back(iter->second);
+        skel.parts.push_back(pMPI::ComputeWrap<GreensFunction>(*iter->second, iter->second->getComplexity()));
+        };
+    std::map<pMPI::JobId, pMPI::WorkerId> job_map = skel.run(comm, false);
+
+    // Only the merged terms are needed to evaluate a Green's function, they are distributed to all processes
+    comm.barrier();
+    MatrixExchange exchange(comm);
+    for(size_t i = 0; i < elements.size(); i++) {
+        int owner = job_map[i];
+        if(comm.rank() == owner && elements[i]->getStatus() != GreensFunction::Computed) {
+            ERROR("Worker" << comm.rank() << " didn't calculate Green's function " << i);
+            throw (std::logic_error("Worker didn't calculate this Green's function."));
+            };
+        exchange.add(elements[i]->Poles, owner);
+        exchange.add(elements[i]->ResiduesRe, owner);
+        exchange.add(elements[i]->ResiduesIm, owner);
+        };
+    exchange.run();
+    for(size_t i = 0; i < elements.size(); i++) elements[i]->setStatus(GreensFunction::Computed);
 }
 
 GreensFunction* GFContainer::createElement(const IndexCombination2& Indices) const
@@ -1,16 +1,22 @@
 #include "pomerol/GreensFunction.h"
 
+#include <algorithm>
+#include <stdexcept>
+
 namespace Pomerol{
 
 GreensFunction::GreensFunction(const StatesClassification& S, const Hamiltonian& H, 
                                const AnnihilationOperator& C, const CreationOperator& CX,
                                const DensityMatrix& DM) :
-    Thermal(DM.beta), ComputableObject(), S(S), H(H), C(C), CX(CX), DM(DM), Vanishing(true)
+    Thermal(DM.beta), ComputableObject(), S(S), H(H), C(C), CX(CX), DM(DM), Vanishing(true),
+    TermsStorage(TreeStorage), ReduceResonanceTolerance(1e-8), SpectralWeightTolerance(0)
 {
 }
 
 GreensFunction::GreensFunction(const GreensFunction& GF) :
-    Thermal(GF.beta), ComputableObject(GF), S(GF.S), H(GF.H), C(GF.C), CX(GF.CX), DM(GF.DM), Vanishing(GF.Vanishing)
+    Thermal(GF.beta), ComputableObject(GF), S(GF.S), H(GF.H), C(GF.C), CX(GF.CX), DM(GF.DM), Vanishing(GF.Vanishing),
+    Poles(GF.Poles), ResiduesRe(GF.ResiduesRe), ResiduesIm(GF.ResiduesIm), TermsStorage(GF.TermsStorage),
+    ReduceResonanceTolerance(GF.ReduceResonanceTolerance), SpectralWeightTolerance(GF.SpectralWeightTolerance)
 {
     for(std::list<GreensFunctionPart*>::const_iterator iter = GF.parts.begin(); iter != GF.parts.end(); iter++)
         parts.push_back(new GreensFunctionPart(**iter));
@@ -45,12 +51,14 @@ void GreensFunction::prepare(void)
         if(Cleft == CXright && Cright == CXleft){
         //DEBUG(S.getQuantumNumbers(Cleft) << "|" << S.getQuantumNumbers(Cright) << "||" << S.getQuantumNumbers(CXleft) << "|" << S.getQuantumNumbers(CXright) );
             // check if retained blocks are included. If not, do not push.
-            if ( DM.isRetained(Cleft) || DM.isRetained(Cright) )
+            if ( DM.isRetained(Cleft) || DM.isRetained(Cright) ) {
                 parts.push_back(new GreensFunctionPart(
                               (AnnihilationOperatorPart&)C.getPartFromLeftIndex(Cleft),
                               (CreationOperatorPart&)CX.getPartFromRightIndex(CXright),
                               H.getPart(Cright), H.getPart(Cleft),
                               DM.getPart(Cright), DM.getPart(Cleft)));
+                parts.back()->setTermStorage(TermsStorage);
+            }
         }
 
         unsigned long CleftInt = Cleft;
@@ -70,12 +78,190 @@ void GreensFunction::compute()
     if(Status<Prepared) prepare();
 
     if(Status<Computed){
-        for(std::list<GreensFunctionPart*>::iterator iter = parts.begin(); iter != parts.end(); iter++)
-            (*iter)->compute();
+        std::vector<GreensFunctionPart*> parts_vector(parts.begin(), parts.end());
+        #ifdef POMEROL_USE_OPENMP
+        #pragma omp parallel for schedule(dynamic)
+        #endif
+        for(long p = 0; p < long(parts_vector.size()); ++p)
+            parts_vector[p]->compute();
+        collectTerms();
     }
     Status = Computed;
 }
 
+RealType GreensFunction::getComplexity() const
+{
+    RealType complexity = 0;
+    for(std::list<GreensFunctionPart*>::const_iterator iter = parts.begin(); iter != parts.end(); iter++)
+        complexity += (*iter)->getComplexity();
+    return complexity;
+}
+
+namespace {
+// Orders the terms by their poles
+struct ComparePoles
+{
+    const std::vector<RealType>& poles;
+    ComparePoles(const std::vector<RealType>& poles) : poles(poles) {};
+    bool operator()(size_t l, size_t r) const { return poles[l] < poles[r]; };
+};
+
+// Orders the terms by the magnitudes of their residues
+struct CompareWeights
+{
+    const std::vector<ComplexType>& residues;
+    CompareWeights(const std::vector<ComplexType>& residues) : residues(residues) {};
+    bool operator()(size_t l, size_t r) const { return std::abs(residues[l]) < std::abs(residues[r]); };
+};
+}
+
+void GreensFunction::collectTerms()
+{
+    std::vector<RealType> poles;
+    std::vector<ComplexType> residues;
+    for(std::list<GreensFunctionPart*>::const_iterator iter = parts.begin(); iter != parts.end(); iter++)
+        (*iter)->getTerms(poles, residues);
+
+    // Merge the terms of all parts into one sorted list, the same way the parts reduce their own terms
+    std::vector<size_t> order(poles.size());
+    for(size_t n = 0; n < order.size(); ++n) order[n] = n;
+    std::sort(order.begin(), order.end(), ComparePoles(poles));
+    std::vector<RealType> merged_poles;
+    std::vector<ComplexType> merged_residues;
+    for(size_t n = 0; n < order.size();){
+        RealType pole = poles[order[n]];
+        ComplexType residue = 0;
+        for(; n < order.size() && poles[order[n]] - pole < ReduceResonanceTolerance; ++n) residue += residues[order[n]];
+        if(residue == ComplexType(0)) continue;
+        merged_poles.push_back(pole);
+        merged_residues.push_back(residue);
+    }
+
+    // Drop the terms with the smallest residues within the tolerance on the total spectral weight
+    std::vector<bool> keep(merged_poles.size(), true);
+    if(SpectralWeightTolerance > 0){
+        std::vector<size_t> by_weight(merged_poles.size());
+        RealType total_weight = 0;
+        for(size_t n = 0; n < by_weight.size(); ++n) { by_weight[n] = n; total_weight += std::abs(merged_residues[n]); }
+        std::sort(by_weight.begin(), by_weight.end(), CompareWeights(merged_residues));
+        RealType dropped_weight = 0;
+        for(size_t n = 0; n < by_weight.size(); ++n){
+            dropped_weight += std::abs(merged_residues[by_weight[n]]);
+            if(dropped_weight > SpectralWeightTolerance*total_weight) break;
+            keep[by_weight[n]] = false;
+        }
+    }
+
+    long size = std::count(keep.begin(), keep.end(), true);
+    Poles.resize(size);
+    ResiduesRe.resize(size);
+    ResiduesIm.resize(size);
+    for(size_t n = 0, m = 0; n < merged_poles.size(); ++n){
+        if(!keep[n]) continue;
+        Poles(m) = merged_poles[n];
+        ResiduesRe(m) = std::real(merged_residues[n]);
+        ResiduesIm(m) = std::imag(merged_residues[n]);
+        ++m;
+    }
+}
+
+ComplexType GreensFunction::evaluateTerms(ComplexType z) const
+{
+    // R/(z - P) = R*(x - P - iy)/((x - P)^2 + y^2) for z = x + iy
+    RealType x = std::real(z), y = std::imag(z);
+    RealType re = ((ResiduesIm*y - ResiduesRe*(Poles - x)) / ((Poles - x).square() + y*y)).sum();
+    RealType im = -((ResiduesIm*(Poles - x) + ResiduesRe*y) / ((Poles - x).square() + y*y)).sum();
+    return ComplexType(re, im);
+}
+
+void GreensFunction::evaluate(const ComplexVectorType& grid, ComplexVectorType& out) const
+{
+    if(Status<Computed) throw std::logic_error("GreensFunction :: evaluate() is called before compute()");
+    out.setZero(grid.size());
+    if(Vanishing) return;
+
+    #ifdef POMEROL_USE_OPENMP
+    #pragma omp parallel for schedule(static)
+    #endif
+    for(long n = 0; n < long(grid.size()); ++n) out(n) = evaluateTerms(grid(n));
+}
+
+ComplexType GreensFunction::of_tau(RealType tau) const
+{
+    if(Vanishing) return 0;
+    // The same as GreensFunctionPart::Term::operator()(tau, beta) for every pole
+    RealArrayType weights = (Poles > 0).select((-tau*Poles).exp()/(1.0 + (-beta*Poles).exp()),
+                                               ((beta-tau)*Poles).exp()/((beta*Poles).exp() + 1.0));
+    return -ComplexType((ResiduesRe*weights).sum(), (ResiduesIm*weights).sum());
+}
+
+namespace {
+typedef Eigen::Array<RealType,Eigen::Dynamic,1> RealArrayType;
+
+// The recurrence on the tau grid is restarted with the exact exponentials after this number of points
+const long TauChunkSize = 128;
+
+// Subtracts sum_p R_p exp(-s_k E_p)/(1 + exp(-beta E_p)) at s_k = k*dtau from out(k), or from out(ntau-1-k) if reversed.
+// All the energies E_p are non-negative, so the recurrence never overflows.
+void subtractDecayingTerms(const RealArrayType& E, const RealArrayType& ResRe, const RealArrayType& ResIm,
+                           RealType beta, RealType dtau, bool reversed, ComplexVectorType& out)
+{
+    if(!E.size()) return;
+    long ntau = out.size();
+    RealArrayType step = (-dtau*E).exp();
+    RealArrayType norm = 1.0/(1.0 + (-beta*E).exp());
+    long NChunks = (ntau + TauChunkSize - 1)/TauChunkSize;
+    #ifdef POMEROL_USE_OPENMP
+    #pragma omp parallel for schedule(static)
+    #endif
+    for(long c = 0; c < NChunks; ++c){
+        RealArrayType weights;
+        for(long k = c*TauChunkSize; k < std::min(ntau, (c+1)*TauChunkSize); ++k){
+            if(k == c*TauChunkSize) weights = (-(k*dtau)*E).exp()*norm;
+            else weights *= step;
+            out(reversed ? ntau-1-k : k) -= ComplexType((ResRe*weights).sum(), (ResIm*weights).sum());
+        }
+    }
+}
+}
+
+void GreensFunction::of_tau_grid(long ntau, ComplexVectorType& out) const
+{
+    if(Status<Computed) throw std::logic_error("GreensFunction :: of_tau_grid() is called before compute()");
+    if(ntau < 2) throw std::invalid_argument("GreensFunction :: the tau grid needs at least two points");
+    out.setZero(ntau);
+    if(Vanishing) return;
+
+    // A positive pole decays with tau as exp(-tau*P), the other ones - with (beta - tau) as exp((beta-tau)*P)
+    long NPositive = (Poles > 0).count();
+    RealArrayType E[2], ResRe[2], ResIm[2];
+    for(int sign = 0; sign < 2; ++sign){
+        long size = sign ? NPositive : Poles.size() - NPositive;
+        E[sign].resize(size); ResRe[sign].resize(size); ResIm[sign].resize(size);
+    }
+    long pos[2] = {0, 0};
+    for(long n = 0; n < Poles.size(); ++n){
+        int sign = Poles(n) > 0;
+        E[sign](pos[sign]) = std::abs(Poles(n));
+        ResRe[sign](pos[sign]) = ResiduesRe(n);
+        ResIm[sign](pos[sign]) = ResiduesIm(n);
+        ++pos[sign];
+    }
+    RealType dtau = beta/(ntau-1);
+    subtractDecayingTerms(E[1], ResRe[1], ResIm[1], beta, dtau, false, out);
+    subtractDecayingTerms(E[0], ResRe[0], ResIm[0], beta, dtau, true, out);
+}
+
+void GreensFunction::getTerms(std::vector<RealType>& poles, std::vector<ComplexType>& residues) const
+{
+    poles.resize(Poles.size());
+    residues.resize(Poles.size());
+    for(long n = 0; n < Poles.size(); ++n){
+        poles[n] = Poles(n);
+        residues[n] = ComplexType(ResiduesRe(n), ResiduesIm(n));
+    }
+}
+
 unsigned short GreensFunction::getIndex(size_t Position) const
 {
     switch(Position){
@@ -37,6 +37,11 @@ GreensFunctionPart::GreensFunctionPart( const AnnihilationOperatorPart& C, const
                                         ReduceTolerance(1e-8)
 {}
 
+void GreensFunctionPart::setTermStorage(TermStorage Storage)
+{
+    Terms.set_storage(Storage);
+}
+
 void GreensFunctionPart::compute(void)
 {
     Terms.clear();
@@ -79,7 +84,32 @@ void GreensFunctionPart::compute(void)
         }
     }
 
+    Terms.reduce();
     assert(Terms.check_terms());
 }
 
+RealType GreensFunctionPart::getComplexity() const
+{
+    const RowMajorMatrixType& Cmatrix = C.getRowMajorValue();
+    const ColMajorMatrixType& CXmatrix = CX.getColMajorValue();
+
+    // <1 | C | 2> <2 | CX | 1>
+    RealType N1 = Cmatrix.rows(), N2 = Cmatrix.cols();
+    if (N1*N2 == 0) return 0;
+
+    RealType NumberOfTerms = RealType(Cmatrix.nonZeros()) * RealType(CXmatrix.nonZeros()) / (N1*N2);
+    return N1 + RealType(Cmatrix.nonZeros()) + RealType(CXmatrix.nonZeros()) + NumberOfTerms;
+}
+
+void GreensFunctionPart::getTerms(std::vector<RealType>& Poles, std::vector<ComplexType>& Residues) const
+{
+    std::vector<Term> terms;
+    terms.reserve(Terms.size());
+    Terms.copy_terms(std::back_inserter(terms));
+    for(std::vector<Term>::const_iterator it = terms.begin(); it != terms.end(); ++it){
+        Poles.push_back(it->Pole);
+        Residues.push_back(it->Residue);
+    }
+}
+
 } // end of namespace Pomerol
@@ -1,6 +1,9 @@
 #include "pomerol/Hamiltonian.h"
+#include "pomerol/MatrixExchange.h"
 #include "mpi_dispatcher/mpi_skel.hpp"
 
+#include <algorithm>
+
 #ifdef ENABLE_SAVE_PLAINTEXT
 #include<boost/filesystem.hpp>
 #endif
@@ -8,7 +11,8 @@
 namespace Pomerol{
 
 Hamiltonian::Hamiltonian(const IndexClassification &IndexInfo, const IndexHamiltonian& F, const StatesClassification &S):
-    ComputableObject(), IndexInfo(IndexInfo), F(F), S(S)
+    ComputableObject(), IndexInfo(IndexInfo), F(F), S(S),
+    SparseBlockSize(0), EnergyWindow(10), EigenTolerance(1e-10)
 {}
 
 Hamiltonian::~Hamiltonian()
@@ -26,6 +30,8 @@ void Hamiltonian::prepare(const boost::mpi::communicator& comm)
     for (BlockNumber CurrentBlock = 0; CurrentBlock < NumberOfBlocks; CurrentBlock++)
     {
 	    parts[CurrentBlock].reset(new HamiltonianPart(IndexInfo,F, S, CurrentBlock));
+        parts[CurrentBlock]->Sparse = SparseBlockSize && S.getBlockSize(CurrentBlock) >= SparseBlockSize;
+        parts[CurrentBlock]->Tolerance = EigenTolerance;
         //parts[CurrentBlock]->prepare();
     }
     pMPI::mpi_skel<pMPI::PrepareWrap<HamiltonianPart> > skel;
@@ -33,20 +39,17 @@ void Hamiltonian::prepare(const boost::mpi::communicator& comm)
     for (size_t i=0; i<parts.size(); i++) { skel.parts[i] = pMPI::PrepareWrap<HamiltonianPart>(*parts[i]);};
     std::map<pMPI::JobId, pMPI::WorkerId> job_map = skel.run(comm,false);
     comm.barrier();
+    MatrixExchange exchange(comm);
     for (size_t p = 0; p<parts.size(); p++) {
-            if (comm.rank() == job_map[p]){
-                if (parts[p]->Status != HamiltonianPart::Prepared) { 
-                    ERROR ("Worker" << comm.rank() << " didn't calculate part" << p); 
-                    throw (std::logic_error("Worker didn't calculate this part."));
-                    };
-                boost::mpi::broadcast(comm, parts[p]->H.data(), parts[p]->H.rows()*parts[p]->H.cols(), comm.rank());
-                }
-            else {
-                parts[p]->H.resize(parts[p]->getSize(),parts[p]->getSize());
-                boost::mpi::broadcast(comm, parts[p]->H.data(), parts[p]->getSize()*parts[p]->getSize(), job_map[p]);
-                parts[p]->Status = HamiltonianPart::Prepared;
-                 };
+            if (comm.rank() == job_map[p] && parts[p]->Status != HamiltonianPart::Prepared) { 
+                ERROR ("Worker" << comm.rank() << " didn't calculate part" << p); 
+                throw (std::logic_error("Worker didn't calculate this part."));
+                };
+            if (parts[p]->Sparse) exchange.add(parts[p]->HSparse, job_map[p]);
+            else exchange.add(parts[p]->H, job_map[p]);
             };
+    exchange.run();
+    for (size_t p = 0; p<parts.size(); p++) parts[p]->Status = HamiltonianPart::Prepared;
     Status = Prepared;
 }
 
@@ -55,41 +58,100 @@ void Hamiltonian::compute(const boost::mpi::communicator & comm)
 {
     if (Status >= Computed) return;
 
-    // Create a "skeleton" class with pointers to part that can call a compute method
-    pMPI::mpi_skel<pMPI::ComputeWrap<HamiltonianPart> > skel;
-    skel.parts.resize(parts.size());
-    for (size_t i=0; i<parts.size(); i++) { skel.parts[i] = pMPI::ComputeWrap<HamiltonianPart>(*parts[i],parts[i]->getSize());};
+    // The dense parts are fully diagonalized, and only the lowest eigenpair of every sparse part is found
+    std::vector<BlockNumber> Blocks, SparseBlocks;
+    for (BlockNumber p = 0; p<BlockNumber(parts.size()); p++) {
+        Blocks.push_back(p);
+        if (parts[p]->Sparse) {
+            SparseBlocks.push_back(p);
+            parts[p]->EnergyCutoff = -std::numeric_limits<RealType>::infinity();
+            };
+        };
+    computeParts(Blocks, comm);
+    computeGroundEnergy();
+
+    // Now the ground energy is known, and the sparse parts are completed up to the energy window
+    if (SparseBlocks.size()) {
+        for (size_t i = 0; i<SparseBlocks.size(); i++) {
+            parts[SparseBlocks[i]]->EnergyCutoff = GroundEnergy + EnergyWindow;
+            parts[SparseBlocks[i]]->Status = HamiltonianPart::Prepared;
+            };
+        computeParts(SparseBlocks, comm);
+        for (size_t i = 0; i<SparseBlocks.size(); i++) parts[SparseBlocks[i]]->HSparse = ColMajorMatrixType();
+        };
+    Status = Computed;
+}
+
+namespace {
+// An mpi adapter to diagonalize either a single large part or a bundle of small parts
+struct ComputeBundleWrap
+{
+    void run(){
+        // The parts of a bundle are diagonalized concurrently. A single part uses the threads within
+        // the sparse products of the Davidson method, or within a threaded BLAS called by the LAPACK eigensolver.
+        #ifdef POMEROL_USE_OPENMP
+        #pragma omp parallel for schedule(dynamic) if(parts_.size() > 1)
+        #endif
+        for (long i = 0; i < long(parts_.size()); ++i) parts_[i]->compute();
+    };
+    ComputeBundleWrap() : complexity(0) {};
+    void addPart(HamiltonianPart *p, RealType part_complexity) { parts_.push_back(p); complexity += part_complexity; };
+    RealType complexity;
+protected:
+    std::vector<HamiltonianPart*> parts_;
+};
+
+}
+
+void Hamiltonian::computeParts(const std::vector<BlockNumber>& Blocks, const boost::mpi::communicator & comm)
+{
+    std::vector<RealType> complexity(Blocks.size());
+    RealType total_complexity = 0;
+    for (size_t i=0; i<Blocks.size(); i++) {
+        complexity[i] = parts[Blocks[i]]->getComplexity();
+        total_complexity += complexity[i];
+        };
+    std::vector<std::vector<size_t> > jobs = pMPI::group_jobs(complexity, comm.size());
+
+    // Create a "skeleton" class with pointers to part that can call a compute method.
+    // The largest parts come first and are separate jobs, the small ones are bundled.
+    pMPI::mpi_skel<ComputeBundleWrap> skel;
+    std::vector<pMPI::JobId> part_jobs(Blocks.size());
+    for (size_t j=0; j<jobs.size(); j++) {
+        skel.parts.push_back(ComputeBundleWrap());
+        for (size_t i=0; i<jobs[j].size(); i++) {
+            size_t p = jobs[j][i];
+            part_jobs[p] = j;
+            skel.parts.back().addPart(parts[Blocks[p]].get(), complexity[p]);
+            };
+        };
+    #ifndef POMEROL_USE_LAPACK
+    // A large dense part taking longer than the share of a process is diagonalized by one thread of the Eigen eigensolver
+    if (comm.rank() == 0 && jobs.size()) {
+        const HamiltonianPart& largest = *parts[Blocks[jobs[0][0]]];
+        if (!largest.Sparse && largest.getSize() >= 1000 && complexity[jobs[0][0]] > total_complexity / comm.size())
+            INFO("Block " << largest.getBlockNumber() << " dominates the diagonalization and runs on a single thread. "
+                 "Configure with -DPOMEROL_USE_LAPACK=ON and link a threaded BLAS to use several threads for it.");
+        };
+    #endif
     std::map<pMPI::JobId, pMPI::WorkerId> job_map = skel.run(comm, true);
     int rank = comm.rank();
-    int comm_size = comm.size(); 
 
     // Start distributing data
     comm.barrier();
-    for (size_t p = 0; p<parts.size(); p++) {
-            if (rank == job_map[p]){
-                if (parts[p]->Status != HamiltonianPart::Computed) { 
-                    ERROR ("Worker" << rank << " didn't calculate part" << p); 
-                    throw (std::logic_error("Worker didn't calculate this part."));
-                    };
-                boost::mpi::broadcast(comm, parts[p]->H.data(), parts[p]->H.rows()*parts[p]->H.cols(), rank);
-                boost::mpi::broadcast(comm, parts[p]->Eigenvalues.data(), parts[p]->H.rows(), rank);
-                }
-            else {
-                parts[p]->Eigenvalues.resize(parts[p]->H.rows());
-                boost::mpi::broadcast(comm, parts[p]->H.data(), parts[p]->H.rows()*parts[p]->H.cols(), job_map[p]);
-                boost::mpi::broadcast(comm, parts[p]->Eigenvalues.data(), parts[p]->H.rows(), job_map[p]);
-                parts[p]->Status = HamiltonianPart::Computed;
-                 };
+    MatrixExchange exchange(comm);
+    for (size_t i = 0; i<Blocks.size(); i++) {
+            HamiltonianPart& part = *parts[Blocks[i]];
+            int owner = job_map[part_jobs[i]];
+            if (rank == owner && part.Status != HamiltonianPart::Computed) { 
+                ERROR ("Worker" << rank << " didn't calculate part" << Blocks[i]); 
+                throw (std::logic_error("Worker didn't calculate this part."));
+                };
+            exchange.add(part.H, owner);
+            exchange.add(part.Eigenvalues, owner);
             };
-/*
-    for (BlockNumber CurrentBlock=0; CurrentBlock<NumberOfBlocks; CurrentBlock++)
-    {
-	    parts[CurrentBlock]->compute();
-	    INFO("Hpart " << CurrentBlock << " (" << S.getQuantumNumbers(CurrentBlock) << ") is diagonalized.");
-    }
-*/
-    computeGroundEnergy();
-    Status = Computed;
+    exchange.run();
+    for (size_t i = 0; i<Blocks.size(); i++) parts[Blocks[i]]->Status = HamiltonianPart::Computed;
 }
 
 void Hamiltonian::reduce(const RealType Cutoff)
@@ -130,7 +192,10 @@ RealType Hamiltonian::getEigenValue(QuantumState state) const
 
 RealVectorType Hamiltonian::getEigenValues() const
 {
-    RealVectorType out(S.getNumberOfStates());
+    size_t NumberOfEigenValues = 0;
+    for (BlockNumber CurrentBlock=0; CurrentBlock<S.NumberOfBlocks(); CurrentBlock++)
+        NumberOfEigenValues += parts[CurrentBlock]->getEigenValues().size();
+    RealVectorType out(NumberOfEigenValues);
     size_t i=0;
     for (BlockNumber CurrentBlock=0; CurrentBlock<S.NumberOfBlocks(); CurrentBlock++) {
         const RealVectorType& tmp = parts[CurrentBlock]->getEigenValues();
@@ -1,6 +1,10 @@
 #include"pomerol/HamiltonianPart.h"
 #include"pomerol/StatesClassification.h"
+#include"pomerol/EigenSolver.h"
 #include<sstream>
+#include<algorithm>
+#include<limits>
+#include<stdexcept>
 #include<Eigen/Eigenvalues>
 
 #ifdef ENABLE_SAVE_PLAINTEXT
@@ -16,30 +20,187 @@ HamiltonianPart::HamiltonianPart(const IndexClassification& IndexInfo, const Ind
     ComputableObject(),
     IndexInfo(IndexInfo),
     F(F), S(S),
-    Block(Block), QN(S.getQuantumNumbers(Block))
+    Block(Block), QN(S.getQuantumNumbers(Block)),
+    Sparse(false), EnergyCutoff(std::numeric_limits<RealType>::infinity()), Tolerance(1e-10)
 {
 }
 
+namespace {
+/** Adds the matrix elements emitted by CompiledOperator::actRight to a column of a block. */
+struct AddToColumn {
+    const StatesClassification& S;
+    BlockNumber Block;
+    MatrixType& H;
+    InnerQuantumState Column;
+    AddToColumn(const StatesClassification& S, BlockNumber Block, MatrixType& H, InnerQuantumState Column) :
+        S(S), Block(Block), H(H), Column(Column) {};
+    void operator()(QuantumState bra, MelemType melem) { H(S.getInnerState(Block, bra), Column) += melem; };
+};
+
+/** Collects the matrix elements emitted by CompiledOperator::actRight for a column of a sparse block. */
+struct AddToTriplets {
+    const StatesClassification& S;
+    BlockNumber Block;
+    std::vector<Eigen::Triplet<MelemType> >& Elements;
+    InnerQuantumState Column;
+    AddToTriplets(const StatesClassification& S, BlockNumber Block, std::vector<Eigen::Triplet<MelemType> >& Elements, InnerQuantumState Column) :
+        S(S), Block(Block), Elements(Elements), Column(Column) {};
+    void operator()(QuantumState bra, MelemType melem) { Elements.push_back(Eigen::Triplet<MelemType>(S.getInnerState(Block, bra), Column, melem)); };
+};
+
+/** A column-major dense matrix for the search subspace of the Davidson method. */
+typedef Eigen::Matrix<MelemType,Eigen::Dynamic,Eigen::Dynamic> BasisType;
+
+/** Fills a vector with reproducible pseudo-random numbers in [-0.5,0.5). */
+void fillRandom(VectorType& v, boost::uint64_t seed)
+{
+    for (long i=0; i<v.size(); ++i) {
+        seed = seed*6364136223846793005ULL + 1442695040888963407ULL;
+        v(i) = RealType(seed >> 11)/RealType(1ULL << 53) - 0.5;
+    }
+}
+
+/** Returns A*x for a hermitian A. Every element of the product is the scalar product of a column of A with x,
+ * so that a large block is multiplied by all threads of the process. */
+VectorType multiplyHermitian(const ColMajorMatrixType& A, const VectorType& x)
+{
+    VectorType y(A.cols());
+    #ifdef POMEROL_USE_OPENMP
+    #pragma omp parallel for schedule(static) if(A.nonZeros() > 100000)
+    #endif
+    for (long j=0; j<A.outerSize(); ++j) y(j) = A.col(j).dot(x);
+    return y;
+}
+
+/** Orthogonalizes a vector to the search subspace V and appends it to V, if it is not (almost) contained in V.
+ * W = A*V is updated accordingly. Returns true if the vector has been appended. */
+bool expandBasis(const ColMajorMatrixType& A, BasisType& V, BasisType& W, VectorType t)
+{
+    RealType norm = t.norm();
+    if (norm == 0) return false;
+    t /= norm;
+    for (int pass=0; pass<2; ++pass) if (V.cols()) t -= V*(V.adjoint()*t);
+    norm = t.norm();
+    if (norm < 1e-8) return false;
+    V.conservativeResize(Eigen::NoChange, V.cols()+1);
+    V.col(V.cols()-1) = t/norm;
+    W.conservativeResize(Eigen::NoChange, W.cols()+1);
+    W.col(W.cols()-1) = multiplyHermitian(A, V.col(V.cols()-1));
+    return true;
+}
+
+/** Computes the lowest eigenpairs of a hermitian sparse matrix with the Davidson method.
+ * A few additional (guard) eigenpairs are iterated as well, so that a cluster of close eigenvalues
+ * is not split by the boundary of the requested part of the spectrum.
+ * \param[in] A The matrix.
+ * \param[in] nev The number of eigenpairs.
+ * \param[in] Tolerance Maximal norm of the residuals of the eigenvectors.
+ * \param[in,out] X Columns of X are used as an initial guess and are replaced with the eigenvectors.
+ * \param[out] Eigenvalues The eigenvalues.
+ */
+void davidson(const ColMajorMatrixType& A, size_t nev, RealType Tolerance, BasisType& X, RealVectorType& Eigenvalues)
+{
+    const size_t MaxIterations = 1000;
+    InnerQuantumState N = A.rows();
+    RealVectorType Diagonal = VectorType(A.diagonal()).real();
+    size_t nblock = std::min<size_t>(N, nev + std::max<size_t>(2, nev/4));
+    size_t MaxBasis = std::min<size_t>(N, std::max<size_t>(4*nblock, nblock+20));
+
+    BasisType V(N,0), W(N,0);
+    for (long i=0; i<X.cols(); ++i) expandBasis(A, V, W, X.col(i));
+    // Complete the initial subspace with the Fock states having the lowest diagonal elements.
+    // They are slightly perturbed in order not to stay within an invariant subspace of a symmetry.
+    std::vector<std::pair<RealType, InnerQuantumState> > order(N);
+    for (InnerQuantumState i=0; i<N; ++i) order[i] = std::make_pair(Diagonal(i), i);
+    std::sort(order.begin(), order.end());
+    VectorType t(N), u(N);
+    for (InnerQuantumState i=0; i<N && size_t(V.cols()) < nblock; ++i) {
+        fillRandom(t, i+1);
+        t *= 1e-2;
+        t(order[i].second) += 1;
+        expandBasis(A, V, W, t);
+    }
+
+    for (size_t iteration=0; iteration<MaxIterations; ++iteration) {
+        BasisType T = V.adjoint()*W;
+        T = 0.5*(T + BasisType(T.adjoint()));
+        Eigen::SelfAdjointEigenSolver<BasisType> Solver(T);
+        size_t nritz = std::min<size_t>(nblock, V.cols());
+        BasisType Y = Solver.eigenvectors().leftCols(nritz);
+        RealVectorType RitzValues = Solver.eigenvalues().head(nritz);
+        BasisType RitzVectors = V*Y;
+        BasisType R = W*Y - RitzVectors*RitzValues.cast<MelemType>().asDiagonal();
+
+        bool converged = (nritz >= nev);
+        std::vector<VectorType> Corrections;
+        for (size_t i=0; i<nritz; ++i) {
+            RealType norm = R.col(i).norm();
+            if (i < nev && norm >= Tolerance) converged = false;
+            if (norm < Tolerance) continue;
+            // Diagonal preconditioner M = D - lambda with Olsen's correction t = M^{-1} r - eps M^{-1} x,
+            // which keeps t orthogonal to x, when M^{-1} r is dominated by the components with D ~ lambda
+            t = R.col(i);
+            u = RitzVectors.col(i);
+            for (InnerQuantumState j=0; j<N; ++j) {
+                RealType d = Diagonal(j) - RitzValues(i);
+                if (std::abs(d) < 1e-8) d = (d < 0 ? -1e-8 : 1e-8);
+                t(j) /= d;
+                u(j) /= d;
+            }
+            t -= (RitzVectors.col(i).dot(t)/RitzVectors.col(i).dot(u))*u;
+            Corrections.push_back(t);
+        }
+        if (converged) {
+            X = RitzVectors.leftCols(nev);
+            Eigenvalues = RitzValues.head(nev);
+            return;
+        }
+
+        // Restart from the current approximations, when the subspace becomes too large
+        if (size_t(V.cols()) + Corrections.size() > MaxBasis) { V = RitzVectors; W = W*Y; }
+        bool expanded = false;
+        for (size_t i=0; i<Corrections.size(); ++i) expanded = expandBasis(A, V, W, Corrections[i]) || expanded;
+        if (!expanded) {
+            fillRandom(t, N + iteration);
+            if (!expandBasis(A, V, W, t)) { // V spans the whole block
+                X = RitzVectors.leftCols(nev);
+                Eigenvalues = RitzValues.head(nev);
+                return;
+            }
+        }
+    }
+    ERROR("HamiltonianPart: the Davidson method has not converged in " << MaxIterations << " iterations.");
+    throw (std::runtime_error("HamiltonianPart: the Davidson method has not converged"));
+}
+}
+
 void HamiltonianPart::prepare()
 {
     size_t BlockSize = S.getBlockSize(Block);
+    CompiledOperator CF(F);
+
+    if (Sparse) {
+        H.resize(0,0);
+        std::vector<Eigen::Triplet<MelemType> > Elements;
+        for(InnerQuantumState right_st=0; right_st<BlockSize; right_st++)
+        {
+            AddToTriplets emit(S, Block, Elements, right_st);
+            CF.actRight(S.getFockState(Block,right_st).to_ulong(), emit);
+        }
+        HSparse.resize(BlockSize,BlockSize);
+        HSparse.setFromTriplets(Elements.begin(), Elements.end());
+        assert(BlockSize == 0 || (ColMajorMatrixType(HSparse.adjoint()) - HSparse).norm() < 100*std::numeric_limits<RealType>::epsilon()*BlockSize);
+        Status = Prepared;
+        return;
+    }
 
     H.resize(BlockSize,BlockSize);
     H.setZero();
-    std::map<FockState,MelemType>::const_iterator melem_it;
 
     for(InnerQuantumState right_st=0; right_st<BlockSize; right_st++)
     {
-        FockState ket = S.getFockState(Block,right_st);
-        std::map<FockState,MelemType> mapStates = F.actRight(ket);
-        for (melem_it=mapStates.begin(); melem_it!=mapStates.end(); melem_it++) {
-            FockState bra = melem_it -> first;
-            MelemType melem = melem_it -> second;
-            //DEBUG("<" << bra << "|" << melem << "|" << F << "|" << ket << ">");
-            InnerQuantumState left_st = S.getInnerState(bra);
-//            if (left_st > right_st) { ERROR("!"); exit(1); };
-            H(left_st,right_st) = melem;
-        }
+        AddToColumn emit(S, Block, H, right_st);
+        CF.actRight(S.getFockState(Block,right_st).to_ulong(), emit);
     }
 
 //    H.triangularView<Eigen::Lower>() = H.triangularView<Eigen::Upper>().transpose();
@@ -51,6 +212,11 @@ void HamiltonianPart::prepare()
 void HamiltonianPart::compute()		//method of diagonalization classificated part of Hamiltonian
 {
     if (Status >= Computed) return;
+    if (Sparse) {
+        computeLowest();
+        Status = Computed;
+        return;
+    }
     if (H.rows() == 1) {
         #ifdef POMEROL_COMPLEX_MATRIX_ELEMENTS
         assert (std::abs(H(0,0) - std::real(H(0,0))) < std::numeric_limits<RealType>::epsilon());
@@ -64,22 +230,63 @@ void HamiltonianPart::compute()		//method of diagonalization classificated part
 	    H(0,0) = 1;
         }
     else {
-	    Eigen::SelfAdjointEigenSolver<MatrixType> Solver(H,Eigen::ComputeEigenvectors);
-	    H = Solver.eigenvectors();
-	    Eigenvalues = Solver.eigenvalues();	// eigenvectors are ready
+	    diagonalize(H, Eigenvalues);	// eigenvectors are ready
     }
     Status = Computed;
 }
 
+void HamiltonianPart::computeLowest()
+{
+    InnerQuantumState N = getSize();
+    // Use the available eigenvectors (e.g. the ground state) as an initial guess
+    BasisType X;
+    if (InnerQuantumState(H.rows()) == N) X = H;
+    size_t nev = std::max<size_t>(1, X.cols());
+
+    while (true) {
+        if (2*nev >= N) {
+            // Most of the spectrum is needed, a full diagonalization is cheaper
+            H = MatrixType(HSparse);
+            diagonalize(H, Eigenvalues);
+            X = H;
+            break;
+        }
+        davidson(HSparse, nev, Tolerance, X, Eigenvalues);
+        if (Eigenvalues(nev-1) > EnergyCutoff) break;
+        nev *= 2;
+    }
+
+    long n = 1;
+    while (n < Eigenvalues.size() && Eigenvalues(n) <= EnergyCutoff) ++n;
+    Eigenvalues.conservativeResize(n);
+    H = X.leftCols(n);
+}
+
+RealType HamiltonianPart::getComplexity() const
+{
+    RealType N = getSize();
+    if (!Sparse) return N*N*N;
+    // The diagonal elements below EnergyCutoff estimate the number of wanted eigenpairs
+    RealVectorType Diagonal = VectorType(HSparse.diagonal()).real();
+    size_t nev = std::max<size_t>(1, (Diagonal.array() <= EnergyCutoff).count());
+    if (2*nev >= N) return N*N*N;
+    // Every iteration of the Davidson method multiplies the block by the search vectors
+    // and orthogonalizes them against a subspace of about 4 times as many vectors
+    const RealType DavidsonIterations = 50;
+    RealType nblock = nev + std::max<size_t>(2, nev/4);
+    return DavidsonIterations * nblock * (RealType(HSparse.nonZeros()) + 16*nblock*N);
+}
 
 MelemType HamiltonianPart::getMatrixElement(InnerQuantumState m, InnerQuantumState n) const	//return  H(m,n)
 {
+    if (Sparse && Status < Computed) return HSparse.coeff(m,n);
     return H(m,n);
 }
 
 RealType HamiltonianPart::getEigenValue(InnerQuantumState state) const // return Eigenvalues(state)
 {
     if ( Status < Computed ) throw (exStatusMismatch());
+    if ( state >= InnerQuantumState(Eigenvalues.size()) ) throw (StatesClassification::exWrongState());
     return Eigenvalues(state);
 }
 
@@ -119,6 +326,7 @@ const MatrixType& HamiltonianPart::getMatrix() const
 VectorType HamiltonianPart::getEigenState(InnerQuantumState state) const
 {
     if ( Status < Computed ) throw (exStatusMismatch());
+    if ( state >= InnerQuantumState(H.cols()) ) throw (StatesClassification::exWrongState());
     return H.col(state);
 }
 
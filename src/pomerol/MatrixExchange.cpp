@@ -0,0 +1,55 @@
+#include "pomerol/MatrixExchange.h"
+
+#include <algorithm>
+
+namespace Pomerol{
+
+/** The storage is described to MPI in blocks of at most this number of bytes, so that the int lengths of MPI cover large matrices. */
+static const size_t ExchangeBlockSize = size_t(1) << 30;
+
+MatrixExchange::MatrixExchange(const boost::mpi::communicator& comm) : Comm(comm)
+{}
+
+void MatrixExchange::run()
+{
+    int rank = Comm.rank();
+    int comm_size = Comm.size();
+    if (comm_size == 1) return;
+
+    // Exchange the dimensions and resize the received matrices
+    std::vector<long> send_dims;
+    for (size_t i=0; i<Items.size(); i++) if (Items[i]->owner == rank) Items[i]->getDimensions(send_dims);
+    std::vector<int> counts;
+    boost::mpi::all_gather(Comm, int(send_dims.size()), counts);
+    std::vector<int> displs(comm_size, 0);
+    for (int p=1; p<comm_size; p++) displs[p] = displs[p-1] + counts[p-1];
+    std::vector<long> dims(size_t(displs[comm_size-1]) + counts[comm_size-1]);
+    if (dims.empty()) return;
+    MPI_Allgatherv(send_dims.empty() ? NULL : &send_dims[0], send_dims.size(), MPI_LONG,
+                   &dims[0], &counts[0], &displs[0], MPI_LONG, Comm);
+    std::vector<const long*> pos(comm_size);
+    for (int p=0; p<comm_size; p++) pos[p] = &dims[0] + displs[p];
+    for (size_t i=0; i<Items.size(); i++) if (Items[i]->owner != rank) Items[i]->resize(pos[Items[i]->owner]);
+
+    // Every process broadcasts its matrices at once, the storage of all of them is described by one datatype
+    for (int owner=0; owner<comm_size; owner++) {
+        std::vector<MPI_Aint> addresses;
+        std::vector<size_t> sizes;
+        for (size_t i=0; i<Items.size(); i++) if (Items[i]->owner == owner) Items[i]->getStorage(addresses, sizes);
+        std::vector<MPI_Aint> block_addresses;
+        std::vector<int> block_lengths;
+        for (size_t b=0; b<addresses.size(); b++)
+            for (size_t offset=0; offset<sizes[b]; offset+=ExchangeBlockSize) {
+                block_addresses.push_back(addresses[b] + MPI_Aint(offset));
+                block_lengths.push_back(std::min(ExchangeBlockSize, sizes[b] - offset));
+                };
+        if (block_addresses.empty()) continue;
+        MPI_Datatype storage_type;
+        MPI_Type_create_hindexed(block_addresses.size(), &block_lengths[0], &block_addresses[0], MPI_BYTE, &storage_type);
+        MPI_Type_commit(&storage_type);
+        MPI_Bcast(MPI_BOTTOM, 1, storage_type, owner, Comm);
+        MPI_Type_free(&storage_type);
+        };
+}
+
+} // end of namespace Pomerol
@@ -37,9 +37,6 @@ boost::tuple<FockState,MelemType> Operator::actRight(const monomial_t &in, const
 {
     if (in.size()==0) return boost::make_tuple(ket, MelemType(1));
     //DEBUG(in << "|" << ket << ">");
-    //ParticleIndex prev_pos_ = ket.size(); // Here we'll store the index of the last operator to speed up sign counting
-    ParticleIndex prev_pos_ = 0;
-    //DEBUG(prev_pos_ <<"|" << ket);
     int sign=1;
     FockState bra = ket;
     unsigned int N=in.size();
@@ -49,13 +46,8 @@ boost::tuple<FockState,MelemType> Operator::actRight(const monomial_t &in, const
             boost::tie(op,ind)=in[i];
             //DEBUG(op << "_" << ind);
             if ((op == creation && bra[ind]) || (op == annihilation && !bra[ind]) ) return boost::make_tuple(ERROR_FOCK_STATE, 0); // This is Pauli principle.
-            if (ind > prev_pos_)
-                for (ParticleIndex j=prev_pos_; j<ind; ++j) { if (bra[j]) sign*=-1; }
-            else
-                for (ParticleIndex j=prev_pos_; j>ind; j--) { if (bra[j]) sign*=-1; }
+            if (count_below(bra, ind) % 2) sign*=-1; // Fermionic sign from the occupied modes before ind
             bra[ind] = (op == creation); // This is c or c^+ acting
-            //prev_pos_ = 0;
-
         }
     return boost::make_tuple(bra, MelemType(sign));
 }
@@ -137,4 +129,37 @@ bool operator==(const Operator &lhs, const Operator &rhs)
     return (lhs.monomials.size() == rhs.monomials.size() && std::equal(lhs.begin(), lhs.end(), rhs.begin()));
 }
 
+//
+// CompiledOperator
+//
+
+CompiledOperator::CompiledOperator(const Operator& op) : NumberOperatorsOnly(true), Constant(0)
+{
+    for (Operator::const_iterator it = op.begin(); it != op.end(); ++it) {
+        MonomialStart.push_back(Steps.size());
+        Coefficients.push_back(it->second);
+        const Operator::monomial_t& m = it->first;
+        if (m.size() == 0) Constant += it->second;
+        else if (m.size() == 2 && boost::get<0>(m[0]) == Operator::creation && boost::get<0>(m[1]) == Operator::annihilation
+                 && boost::get<1>(m[0]) == boost::get<1>(m[1]) && boost::get<1>(m[0]) < FixedFockState::MaxSize) {
+            mask_type mask = mask_type(1) << boost::get<1>(m[0]);
+            size_t w = 0;
+            while (w < NumberWeights.size() && NumberWeights[w] != it->second) ++w;
+            if (w == NumberWeights.size()) { NumberWeights.push_back(it->second); NumberMasks.push_back(0); };
+            NumberMasks[w] |= mask;
+        }
+        else NumberOperatorsOnly = false;
+        for (int i = int(m.size())-1; i >= 0; --i) { // Operators act from the right
+            ParticleIndex ind = boost::get<1>(m[i]);
+            if (ind >= FixedFockState::MaxSize) throw std::length_error("CompiledOperator : too many modes");
+            Step step;
+            step.Mask = mask_type(1) << ind;
+            step.Below = step.Mask - 1;
+            step.Required = (boost::get<0>(m[i]) == Operator::creation) ? 0 : step.Mask;
+            Steps.push_back(step);
+        }
+    }
+    MonomialStart.push_back(Steps.size());
+}
+
 } // end of namespace Pomerol
@@ -1,5 +1,8 @@
 #include "pomerol/StatesClassification.h"
 
+#include <algorithm>
+#include <cmath>
+
 namespace Pomerol{
 
 bool BlockNumber::operator<(const BlockNumber& rhs) const {return number<rhs.number;}
@@ -16,44 +19,269 @@ StatesClassification::StatesClassification(const IndexClassification& IndexInfo,
 {
 }
 
+namespace {
+/** States of a contiguous range of Fock states, classified into blocks in the order of their first appearance. */
+struct StatesChunk {
+    boost::unordered_map<QuantumNumbers, size_t> KeyToBlock;
+    std::vector<QuantumNumbers> Keys;
+    std::vector<std::vector<QuantumState> > States;
+};
+}
+
+void StatesClassification::evaluateQuantumNumbers(QuantumState state, QuantumNumbers& QNumbers) const
+{
+    const std::vector<int>& Moduli = Symm.getModuli();
+    for (size_t n=0; n<SymmetryOperations.size(); ++n) {
+        MelemType value = SymmetryOperations[n].getDiagonalElement(state);
+        if (Moduli[n]) { // A parity-like quantum number, the operation has integer eigenvalues
+            long v = long(std::floor(std::real(ComplexType(value)) + 0.5)) % Moduli[n];
+            value = v < 0 ? v + Moduli[n] : v;
+            };
+        QNumbers.set(n, value);
+        };
+}
+
 void StatesClassification::compute()             
 {
     if (Status>=Computed) return;
     IndexSize = IndexInfo.getIndexSize();
-    StateSize = 1<<IndexSize;
-    std::vector<boost::shared_ptr<Operator> > sym_op = Symm.getOperations();
-    int NOperations=sym_op.size();
-    BlockNumber block_index=0;
-    for (QuantumState FockStateIndex=0; FockStateIndex<StateSize; ++FockStateIndex) {
-        FockState current_state(IndexSize,FockStateIndex);
+    StateSize = 1ul<<IndexSize;
+    const std::vector<boost::shared_ptr<Operator> >& sym_op = Symm.getOperations();
+    SymmetryOperations.clear();
+    for (size_t n=0; n<sym_op.size(); ++n) SymmetryOperations.push_back(CompiledOperator(*sym_op[n]));
+    Binomials.assign(IndexSize+1, std::vector<QuantumState>(IndexSize+1, 0));
+    for (ParticleIndex n=0; n<=IndexSize; ++n) {
+        Binomials[n][0] = 1;
+        for (ParticleIndex k=1; k<=n; ++k) Binomials[n][k] = Binomials[n-1][k-1] + (k < n ? Binomials[n-1][k] : 0);
+        };
+
+    if (!generateBlocks()) classifyAllStates();
+    Status = Computed;
+}
+
+void StatesClassification::classifyAllStates()
+{
+    // The Fock states are split into contiguous chunks, which are classified concurrently.
+    // Every state is visited once as an integer, no per-state containers are created.
+    int NChunks = 1;
+    #ifdef POMEROL_USE_OPENMP
+    NChunks = omp_get_max_threads();
+    #endif
+    if (QuantumState(NChunks) > StateSize) NChunks = StateSize;
+    std::vector<StatesChunk> Chunks(NChunks);
+    #ifdef POMEROL_USE_OPENMP
+    #pragma omp parallel for schedule(static)
+    #endif
+    for (int c=0; c<NChunks; ++c) {
+        StatesChunk& chunk = Chunks[c];
         QuantumNumbers QNumbers(Symm.getQuantumNumbers());
-        for (int n=0; n<NOperations; ++n) {
-            MelemType Value=sym_op[n]->getMatrixElement(current_state, current_state);
-            QNumbers.set(n,Value);
+        QuantumState begin = StateSize/NChunks*c + std::min<QuantumState>(c, StateSize%NChunks);
+        QuantumState end = begin + StateSize/NChunks + (QuantumState(c) < StateSize%NChunks);
+        for (QuantumState state=begin; state<end; ++state) {
+            evaluateQuantumNumbers(state, QNumbers);
+            boost::unordered_map<QuantumNumbers, size_t>::iterator it = chunk.KeyToBlock.find(QNumbers);
+            if (it == chunk.KeyToBlock.end()) {
+                it = chunk.KeyToBlock.insert(std::make_pair(QNumbers, chunk.States.size())).first;
+                chunk.Keys.push_back(QNumbers);
+                chunk.States.push_back(std::vector<QuantumState>());
+                };
+            chunk.States[it->second].push_back(state);
+            };
         }
-        std::map<QuantumNumbers, BlockNumber>::iterator map_pos=QuantumToBlock.find(QNumbers);
-        if (map_pos==QuantumToBlock.end()) {
-//            DEBUG("Adding " << current_state << " to block " << block_index << " with QuantumNumbers " << QNumbers << ".");
-            QuantumToBlock[QNumbers]=block_index;
-            BlockToQuantum.insert(std::make_pair(block_index, QNumbers)); // Needed not to invoke an empty constructor.
-            StatesContainer.push_back(std::vector<FockState>(0));
-            StatesContainer[block_index].push_back(current_state);
-            StateBlockIndex.push_back(block_index);
-            block_index++;
-            }
-         else {
-//            DEBUG("Adding " << current_state << " to block " << map_pos->second << " with QuantumNumbers " << QNumbers << ".");
-            StatesContainer[map_pos->second].push_back(current_state);
-            StateBlockIndex.push_back(map_pos->second);
+
+    // Merge the chunks in order, so that the blocks are numbered by the first appearance of their states
+    // and the states within a block are sorted.
+    for (int c=0; c<NChunks; ++c) {
+        StatesChunk& chunk = Chunks[c];
+        for (size_t b=0; b<chunk.States.size(); ++b) {
+            const QuantumNumbers& QNumbers = chunk.Keys[b];
+            boost::unordered_map<QuantumNumbers, BlockNumber>::iterator it = QuantumToBlock.find(QNumbers);
+            if (it == QuantumToBlock.end()) {
+                BlockNumber block_index = StatesContainer.size();
+                it = QuantumToBlock.insert(std::make_pair(QNumbers, block_index)).first;
+                BlockToQuantum.insert(std::make_pair(block_index, QNumbers)); // Needed not to invoke an empty constructor.
+                StatesContainer.push_back(std::vector<FockState>(0));
+                };
+            std::vector<FockState>& states = StatesContainer[it->second];
+            states.reserve(states.size() + chunk.States[b].size());
+            for (size_t i=0; i<chunk.States[b].size(); ++i) states.push_back(FockState(IndexSize, chunk.States[b][i]));
+            std::vector<QuantumState>().swap(chunk.States[b]);
             };
         }
-    Status = Computed;
+}
+
+namespace {
+/** Returns all subsets of the bits of mask, which have k bits. */
+std::vector<QuantumState> subsetsOfSize(QuantumState mask, int k)
+{
+    std::vector<QuantumState> bits;
+    for (QuantumState m = mask; m; m &= m-1) bits.push_back(m & (~m + 1));
+    std::vector<QuantumState> out;
+    if (k == 0) { out.push_back(0); return out; };
+    // Iterate over the combinations of k out of bits.size() positions in the lexicographic order (Gosper's hack)
+    for (QuantumState c = (QuantumState(1) << k) - 1; c < (QuantumState(1) << bits.size()); ) {
+        QuantumState subset = 0;
+        for (size_t i = 0; i < bits.size(); ++i) if (c & (QuantumState(1) << i)) subset |= bits[i];
+        out.push_back(subset);
+        QuantumState u = c & (~c + 1), v = c + u;
+        c = v + (((v ^ c) / u) >> 2);
+        };
+    return out;
+}
+
+/** Returns the lowest state with k bits of mask. */
+QuantumState lowestSubset(QuantumState mask, int k)
+{
+    QuantumState out = 0;
+    for (; k > 0; --k, mask &= mask-1) out |= mask & (~mask + 1);
+    return out;
+}
+
+/** Occupation numbers of the classes of equivalent modes, which give the states of a block. */
+struct BlockOccupations {
+    /** The lowest state of the block */
+    QuantumState First;
+    /** Numbers of occupied modes of every class, one set for every part of the block */
+    std::vector<std::vector<int> > Occupations;
+};
+
+/** Orders blocks by their lowest states. */
+struct CompareFirstState {
+    const std::vector<BlockOccupations>& Blocks;
+    CompareFirstState(const std::vector<BlockOccupations>& Blocks) : Blocks(Blocks) {};
+    bool operator()(size_t l, size_t r) const { return Blocks[l].First < Blocks[r].First; };
+};
+}
+
+bool StatesClassification::generateBlocks()
+{
+    for (size_t n=0; n<SymmetryOperations.size(); ++n)
+        if (!SymmetryOperations[n].isNumberOperatorsOnly()) return false;
+
+    // Modes having the same weights in all operations are equivalent: the quantum numbers of a state
+    // depend only on the numbers of occupied modes of every class.
+    ClassMasks.clear();
+    std::vector<std::vector<MelemType> > ClassWeights;
+    for (ParticleIndex i=0; i<IndexSize; ++i) {
+        std::vector<MelemType> weights(SymmetryOperations.size());
+        for (size_t n=0; n<SymmetryOperations.size(); ++n)
+            weights[n] = SymmetryOperations[n].getDiagonalElement(QuantumState(1) << i) - SymmetryOperations[n].getDiagonalElement(0);
+        size_t c = std::find(ClassWeights.begin(), ClassWeights.end(), weights) - ClassWeights.begin();
+        if (c == ClassWeights.size()) { ClassWeights.push_back(weights); ClassMasks.push_back(0); };
+        ClassMasks[c] |= QuantumState(1) << i;
+        };
+    std::vector<int> ClassSizes(ClassMasks.size());
+    RealType NOccupations = 1;
+    for (size_t c=0; c<ClassMasks.size(); ++c) {
+        ClassSizes[c] = FixedFockState::popcount(ClassMasks[c]);
+        NOccupations *= ClassSizes[c] + 1;
+        };
+    // All modes are distinguished by the symmetries, so that the scan of the states is as fast
+    if (NOccupations >= StateSize) { ClassMasks.clear(); return false; };
+
+    // The tables to rank the states within their blocks
+    size_t NClasses = ClassMasks.size();
+    ModeClasses.assign(IndexSize, 0);
+    ModesBelow.assign(IndexSize*NClasses, 0);
+    for (ParticleIndex i=0; i<IndexSize; ++i)
+        for (size_t c=0; c<NClasses; ++c) {
+            if (ClassMasks[c] & (QuantumState(1) << i)) ModeClasses[i] = c;
+            ModesBelow[i*NClasses + c] = FixedFockState::popcount(ClassMasks[c] & ((QuantumState(1) << i) - 1));
+            };
+
+    // Group the sets of occupation numbers into blocks by the quantum numbers of their lowest states
+    std::vector<BlockOccupations> Blocks;
+    std::vector<QuantumNumbers> Keys;
+    boost::unordered_map<QuantumNumbers, size_t> KeyToBlock;
+    QuantumNumbers QNumbers(Symm.getQuantumNumbers());
+    std::vector<int> k(ClassMasks.size(), 0);
+    while (true) {
+        QuantumState first = 0;
+        for (size_t c=0; c<ClassMasks.size(); ++c) first |= lowestSubset(ClassMasks[c], k[c]);
+        evaluateQuantumNumbers(first, QNumbers);
+        boost::unordered_map<QuantumNumbers, size_t>::iterator it = KeyToBlock.find(QNumbers);
+        if (it == KeyToBlock.end()) {
+            it = KeyToBlock.insert(std::make_pair(QNumbers, Blocks.size())).first;
+            Keys.push_back(QNumbers);
+            Blocks.push_back(BlockOccupations());
+            Blocks.back().First = first;
+            };
+        BlockOccupations& block = Blocks[it->second];
+        block.First = std::min(block.First, first);
+        block.Occupations.push_back(k);
+        // Next set of occupation numbers
+        size_t c = 0;
+        while (c < k.size() && k[c] == ClassSizes[c]) k[c++] = 0;
+        if (c == k.size()) break;
+        ++k[c];
+        };
+
+    // Number the blocks by their lowest states, as the scan of all states does
+    std::vector<size_t> order(Blocks.size());
+    for (size_t b=0; b<Blocks.size(); ++b) order[b] = b;
+    std::sort(order.begin(), order.end(), CompareFirstState(Blocks));
+    StatesContainer.resize(Blocks.size());
+    Occupations.resize(Blocks.size());
+    for (size_t i=0; i<order.size(); ++i) {
+        BlockNumber block_index = i;
+        const std::vector<std::vector<int> >& occupations = Blocks[order[i]].Occupations;
+        for (size_t o=0; o<occupations.size(); ++o) Occupations[i].insert(Occupations[i].end(), occupations[o].begin(), occupations[o].end());
+        QuantumToBlock.insert(std::make_pair(Keys[order[i]], block_index));
+        BlockToQuantum.insert(std::make_pair(block_index, Keys[order[i]]));
+        };
+
+    // The states of a block are the products of the subsets of every class with the given numbers of occupied modes
+    #ifdef POMEROL_USE_OPENMP
+    #pragma omp parallel for schedule(dynamic)
+    #endif
+    for (long i=0; i<long(order.size()); ++i) {
+        const BlockOccupations& block = Blocks[order[i]];
+        std::vector<QuantumState> states;
+        for (size_t o=0; o<block.Occupations.size(); ++o) {
+            std::vector<QuantumState> products(1, 0);
+            for (size_t c=0; c<ClassMasks.size(); ++c) {
+                std::vector<QuantumState> subsets = subsetsOfSize(ClassMasks[c], block.Occupations[o][c]);
+                std::vector<QuantumState> next;
+                next.reserve(products.size() * subsets.size());
+                for (size_t p=0; p<products.size(); ++p)
+                    for (size_t s=0; s<subsets.size(); ++s) next.push_back(products[p] | subsets[s]);
+                products.swap(next);
+                };
+            states.insert(states.end(), products.begin(), products.end());
+            };
+        std::sort(states.begin(), states.end());
+        std::vector<FockState>& out = StatesContainer[i];
+        out.reserve(states.size());
+        for (size_t s=0; s<states.size(); ++s) out.push_back(FockState(IndexSize, states[s]));
+        }
+    return true;
+}
+
+QuantumState StatesClassification::countLowerStates(QuantumState state, const int* occupations) const
+{
+    // A lower state coincides with state above some occupied mode i of state and has i empty.
+    // The modes below i are filled with the remaining numbers of particles of every class in any way.
+    size_t NClasses = ClassMasks.size();
+    int left[FixedFockState::MaxSize];
+    std::copy(occupations, occupations + NClasses, left);
+    QuantumState out = 0;
+    for (ParticleIndex i=IndexSize; i-- > 0; ) {
+        if (!(state & (QuantumState(1) << i))) continue;
+        const int* below = &ModesBelow[i*NClasses];
+        QuantumState count = 1;
+        for (size_t c=0; c<NClasses && count; ++c)
+            count = (left[c] < 0 || left[c] > below[c]) ? 0 : count * Binomials[below[c]][left[c]];
+        out += count;
+        if (--left[ModeClasses[i]] < 0) break;
+        };
+    return out;
 }
 
 BlockNumber StatesClassification::getBlockNumber(QuantumNumbers in) const
 {
     if ( Status < Computed ) { ERROR("StatesClassification is not computed yet."); throw (exStatusMismatch()); };
-    return (QuantumToBlock.count(in))?QuantumToBlock.find(in)->second:ERROR_BLOCK_NUMBER;
+    boost::unordered_map<QuantumNumbers,BlockNumber>::const_iterator it=QuantumToBlock.find(in);
+    return (it != QuantumToBlock.end())?it->second:ERROR_BLOCK_NUMBER;
 }
 
 const unsigned long StatesClassification::getNumberOfStates() const
@@ -63,36 +291,56 @@ const unsigned long StatesClassification::getNumberOfStates() const
 
 BlockNumber StatesClassification::getBlockNumber(FockState in) const
 {
-    if ( Status < Computed ) { ERROR("StatesClassification is not computed yet."); throw (exStatusMismatch()); };
-    if ( in.to_ulong() > StateSize ) { throw exWrongState(); };
-    return StateBlockIndex[in.to_ulong()];
+    return getBlockNumber(QuantumState(in.to_ulong()));
 }
 
 BlockNumber StatesClassification::getBlockNumber(QuantumState in) const
 {
     if ( Status < Computed ) { ERROR("StatesClassification is not computed yet."); throw (exStatusMismatch()); };
-    if ( in > StateSize ) { throw exWrongState(); };
-    return StateBlockIndex[in];
+    if ( in >= StateSize ) { throw exWrongState(); };
+    QuantumNumbers QNumbers(Symm.getQuantumNumbers());
+    evaluateQuantumNumbers(in, QNumbers);
+    return getBlockNumber(QNumbers);
 }
 
-const InnerQuantumState StatesClassification::getInnerState(FockState state) const
+namespace {
+/** Compares a Fock state with an integer state. */
+struct LessThanState {
+    bool operator()(const FockState& a, QuantumState b) const { return a.to_ulong() < b; };
+};
+}
+
+const InnerQuantumState StatesClassification::getInnerState(BlockNumber in, QuantumState state) const
 {
     if ( Status < Computed ) { ERROR("StatesClassification is not computed yet."); throw (exStatusMismatch()); };
-    if ( state.to_ulong() > StateSize ) { throw (exWrongState()); return StateSize; };
-    BlockNumber block = this->getBlockNumber(state);
-    for (InnerQuantumState n=0; n<StatesContainer[block].size(); n++ )
-      {    
-          if ( StatesContainer[block][n]== state) { return n; } 
-      }
-    throw (exWrongState());
-    return StateSize;
+    if ( in == ERROR_BLOCK_NUMBER || in.number >= int(StatesContainer.size()) ) { throw (exWrongState()); };
+    if ( !ClassMasks.empty() ) {
+        // The states of a generated block are ranked by the numbers of lower states of every part of the block
+        size_t NClasses = ClassMasks.size();
+        int k[FixedFockState::MaxSize];
+        for (size_t c=0; c<NClasses; ++c) k[c] = FixedFockState::popcount(state & ClassMasks[c]);
+        const std::vector<int>& occupations = Occupations[in];
+        bool found = false;
+        for (size_t o=0; o<occupations.size() && !found; o+=NClasses) found = std::equal(k, k + NClasses, &occupations[o]);
+        if ( state >= StateSize || !found ) { throw (exWrongState()); };
+        InnerQuantumState out = 0;
+        for (size_t o=0; o<occupations.size(); o+=NClasses) out += countLowerStates(state, &occupations[o]);
+        return out;
+        };
+    const std::vector<FockState>& states = StatesContainer[in];
+    std::vector<FockState>::const_iterator it = std::lower_bound(states.begin(), states.end(), state, LessThanState());
+    if ( it == states.end() || it->to_ulong() != state ) { throw (exWrongState()); };
+    return it - states.begin();
+}
+
+const InnerQuantumState StatesClassification::getInnerState(FockState state) const
+{
+    return getInnerState(QuantumState(state.to_ulong()));
 }
 
 const InnerQuantumState StatesClassification::getInnerState(QuantumState state) const
 {
-    if ( Status < Computed ) { ERROR("StatesClassification is not computed yet."); throw (exStatusMismatch()); };
-    if ( state > StateSize ) { throw (exWrongState()); return StateSize; };
-    return this->getInnerState(FockState(IndexSize, state));
+    return getInnerState(getBlockNumber(state), state);
 }
 
 const std::vector<FockState>& StatesClassification::getFockStates( BlockNumber in ) const
@@ -104,7 +352,7 @@ const std::vector<FockState>& StatesClassification::getFockStates( BlockNumber i
 const std::vector<FockState>& StatesClassification::getFockStates( QuantumNumbers in ) const
 {
     if ( Status < Computed ) { ERROR("StatesClassification is not computed yet."); throw (exStatusMismatch()); };
-    std::map<QuantumNumbers,BlockNumber>::const_iterator it=QuantumToBlock.find(in);
+    boost::unordered_map<QuantumNumbers,BlockNumber>::const_iterator it=QuantumToBlock.find(in);
     if (it != QuantumToBlock.end())
         return this->getFockStates(it->second);
     else
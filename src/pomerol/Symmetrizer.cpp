@@ -1,5 +1,8 @@
 #include "pomerol/Symmetrizer.h"
 #include "pomerol/OperatorPresets.h"
+#include <algorithm>
+#include <cmath>
+#include <boost/cstdint.hpp>
 
 namespace Pomerol {
 
@@ -103,15 +106,16 @@ const char* Symmetrizer::IndexPermutation::exEqualIndices::what() const throw(){
 // Symmetrizer::QuantumNumbers
 //
 
-Symmetrizer::QuantumNumbers::QuantumNumbers(int amount):amount(amount),numbers( std::vector<MelemType>(amount) ),NumbersHash(numbers_hash_generator(numbers))
+Symmetrizer::QuantumNumbers::QuantumNumbers(int amount):amount(amount)
 {
+    if (amount > MaxAmount) throw (exWrongNumbers());
+    std::fill(numbers, numbers + MaxAmount, 0);
 };
 
 bool Symmetrizer::QuantumNumbers::set ( int pos, MelemType val )
 {
     if (pos<amount) {
-        numbers[pos] = val;
-        NumbersHash = numbers_hash_generator(numbers);
+        numbers[pos] = boost::int64_t(std::floor(std::real(ComplexType(val))*Resolution + 0.5));
         }
     else {
         ERROR("Tried to insert element " << val << " to wrong position " << pos << " in " << __PRETTY_FUNCTION__ );
@@ -120,19 +124,25 @@ bool Symmetrizer::QuantumNumbers::set ( int pos, MelemType val )
     return true;
 }
 
+RealType Symmetrizer::QuantumNumbers::get ( int pos ) const
+{
+    return RealType(numbers[pos])/Resolution;
+}
+
 bool Symmetrizer::QuantumNumbers::operator< (const Symmetrizer::QuantumNumbers& rhs) const
 {
-    return (NumbersHash<rhs.NumbersHash);
+    if (amount != rhs.amount) return amount < rhs.amount;
+    return std::lexicographical_compare(numbers, numbers + amount, rhs.numbers, rhs.numbers + rhs.amount);
 }
 
 bool Symmetrizer::QuantumNumbers::operator== (const Symmetrizer::QuantumNumbers& rhs) const
 {
-    return (NumbersHash==rhs.NumbersHash);
+    return amount == rhs.amount && std::equal(numbers, numbers + amount, rhs.numbers);
 }
 
 bool Symmetrizer::QuantumNumbers::operator!= (const Symmetrizer::QuantumNumbers& rhs) const
 {
-    return (NumbersHash!=rhs.NumbersHash);
+    return !(*this == rhs);
 }
 
 //
@@ -143,7 +153,9 @@ Symmetrizer::Symmetrizer(const IndexClassification &IndexInfo, const IndexHamilt
     ComputableObject(),
     IndexInfo(IndexInfo),
     Storage(Storage),
-    NSymmetries(0)
+    NSymmetries(0),
+    FindAbelianSymmetries(false),
+    FindPermutations(false)
 {
 }
 
@@ -159,6 +171,28 @@ const std::vector<boost::shared_ptr<Operator> >& Symmetrizer::getOperations() co
     return Operations;
 }
 
+const std::vector<DynamicIndexCombination>& Symmetrizer::getPermutations() const
+{
+    return Permutations;
+}
+
+const std::vector<int>& Symmetrizer::getModuli() const
+{
+    return Moduli;
+}
+
+bool Symmetrizer::addSymmetry(const Operator &in, int modulus)
+{
+    if (NSymmetries >= QuantumNumbers::MaxAmount) {
+        ERROR("Symmetrizer: too many integrals of motion, " << in << " is ignored");
+        return false;
+        };
+    Operations.push_back(boost::shared_ptr<Operator>(new Operator(in)));
+    Moduli.push_back(modulus);
+    NSymmetries++;
+    return true;
+}
+
 bool Symmetrizer::checkSymmetry(const Operator &in)
 {
     boost::shared_ptr<Operator> OP1 ( new Operator(in));
@@ -171,11 +205,173 @@ bool Symmetrizer::checkSymmetry(const Operator &in)
         if (!OperatorPresets::n(i).commutes(*OP1)) return false;
     }
 
-    Operations.push_back(OP1);
-    NSymmetries++;
+    return addSymmetry(*OP1, 0);
+}
+
+namespace {
+/** The accuracy of the elimination of the charge equations. */
+const RealType ChargeTolerance = 1e-8;
+/** The largest denominator of the charges, which are scaled to integers. */
+const int MaxChargeDenominator = 12;
+
+/** Brings A to the reduced row echelon form and returns the columns of the pivots. */
+std::vector<int> reduceRows(RealMatrixType& A)
+{
+    std::vector<int> pivots;
+    int row = 0;
+    for (int col = 0; col < A.cols() && row < A.rows(); ++col) {
+        int best;
+        if (A.col(col).tail(A.rows() - row).cwiseAbs().maxCoeff(&best) < ChargeTolerance) continue;
+        A.row(row).swap(A.row(row + best));
+        A.row(row) /= A(row, col);
+        for (int r = 0; r < A.rows(); ++r)
+            if (r != row && std::abs(A(r, col)) > 0) A.row(r) -= A(r, col) * A.row(row);
+        pivots.push_back(col);
+        ++row;
+        };
+    return pivots;
+}
+
+/** Scales the charges to integers. Returns false if they are not rational with a small denominator. */
+bool scaleToIntegers(std::vector<RealType>& q)
+{
+    for (int m = 1; m <= MaxChargeDenominator; ++m) {
+        bool integer = true;
+        for (size_t i = 0; i < q.size() && integer; ++i) integer = std::abs(m*q[i] - std::floor(m*q[i] + 0.5)) < ChargeTolerance;
+        if (!integer) continue;
+        for (size_t i = 0; i < q.size(); ++i) q[i] = std::floor(m*q[i] + 0.5);
+        return true;
+        };
+    return false;
+}
+
+/** Reads off the charges q_i of an operator of the form sum_i q_i n_i + const. Returns false for other operators. */
+bool getCharges(const Operator& op, ParticleIndex IndexSize, std::vector<RealType>& q)
+{
+    q.assign(IndexSize, 0.0);
+    for (Operator::const_iterator it = op.begin(); it != op.end(); ++it) {
+        const Operator::monomial_t& m = it->first;
+        if (m.size() == 0) continue;
+        if (m.size() != 2 || boost::get<0>(m[0]) != Operator::creation || boost::get<0>(m[1]) != Operator::annihilation
+            || boost::get<1>(m[0]) != boost::get<1>(m[1])) return false;
+        q[boost::get<1>(m[0])] += std::real(ComplexType(it->second));
+        };
     return true;
 }
 
+/** A basis of bit vectors over GF(2), reduced by the highest bit. */
+struct ParityBasis
+{
+    std::vector<boost::uint64_t> Vectors;
+    ParityBasis() : Vectors(64, 0) {};
+    /** Adds a vector to the basis. Returns false if it is a combination of the basis vectors. */
+    bool insert(boost::uint64_t v) {
+        for (int b = 63; b >= 0; --b) {
+            if (!((v >> b) & 1)) continue;
+            if (!Vectors[b]) { Vectors[b] = v; return true; };
+            v ^= Vectors[b];
+            };
+        return false;
+    };
+};
+}
+
+void Symmetrizer::findAbelianSymmetries()
+{
+    // A monomial changes the charge sum_i q_i n_i by sum_i q_i (creations_i - annihilations_i).
+    // The charge is conserved if this vanishes for all monomials, and its parity is conserved if
+    // sum_i q_i (creations_i + annihilations_i) is even.
+    std::set<std::vector<int> > ChargeRows;
+    std::set<boost::uint64_t> ParityRows;
+    bool FindParities = IndexSize <= 64;
+    for (Operator::const_iterator it = Storage.begin(); it != Storage.end(); ++it) {
+        std::vector<int> row(IndexSize, 0);
+        boost::uint64_t parity_row = 0;
+        for (size_t n = 0; n < it->first.size(); ++n) {
+            ParticleIndex ind = boost::get<1>(it->first[n]);
+            row[ind] += (boost::get<0>(it->first[n]) == Operator::creation) ? 1 : -1;
+            if (FindParities) parity_row ^= boost::uint64_t(1) << ind;
+            };
+        if (std::count(row.begin(), row.end(), 0) != int(IndexSize)) ChargeRows.insert(row);
+        if (parity_row) ParityRows.insert(parity_row);
+        };
+
+    // The charges, which are already conserved, span the space to be extended
+    std::vector<std::vector<RealType> > Charges;
+    ParityBasis Parities;
+    for (size_t n = 0; n < Operations.size(); ++n) {
+        std::vector<RealType> q;
+        if (Moduli[n] || !getCharges(*Operations[n], IndexSize, q)) continue;
+        Charges.push_back(q);
+        if (FindParities && scaleToIntegers(q)) {
+            boost::uint64_t v = 0;
+            for (ParticleIndex i = 0; i < IndexSize; ++i) if (long(q[i]) % 2) v |= boost::uint64_t(1) << i;
+            Parities.insert(v);
+            };
+        };
+
+    // The null space of the charge equations
+    RealMatrixType A(ChargeRows.size(), IndexSize);
+    int r = 0;
+    for (std::set<std::vector<int> >::const_iterator it = ChargeRows.begin(); it != ChargeRows.end(); ++it, ++r)
+        for (ParticleIndex i = 0; i < IndexSize; ++i) A(r, i) = (*it)[i];
+    std::vector<int> pivots = reduceRows(A);
+    std::vector<bool> is_pivot(IndexSize, false);
+    for (size_t p = 0; p < pivots.size(); ++p) is_pivot[pivots[p]] = true;
+    for (ParticleIndex f = 0; f < IndexSize; ++f) {
+        if (is_pivot[f]) continue;
+        std::vector<RealType> q(IndexSize, 0.0);
+        q[f] = 1.0;
+        for (size_t p = 0; p < pivots.size(); ++p) q[pivots[p]] = -A(p, f);
+        if (!scaleToIntegers(q)) continue;
+
+        // Skip the charges, which are combinations of the known ones
+        RealMatrixType span(Charges.size() + 1, IndexSize);
+        for (size_t c = 0; c < Charges.size(); ++c) for (ParticleIndex i = 0; i < IndexSize; ++i) span(c, i) = Charges[c][i];
+        for (ParticleIndex i = 0; i < IndexSize; ++i) span(Charges.size(), i) = q[i];
+        if (reduceRows(span).size() <= Charges.size()) continue;
+
+        Operator op;
+        boost::uint64_t v = 0;
+        for (ParticleIndex i = 0; i < IndexSize; ++i) if (q[i]) {
+            op += OperatorPresets::n(i) * MelemType(q[i]);
+            if (i < 64 && long(q[i]) % 2) v |= boost::uint64_t(1) << i;
+            }
+        if (!addSymmetry(op, 0)) return;
+        INFO("[ H ," << op << " ]=0");
+        Charges.push_back(q);
+        if (FindParities) Parities.insert(v);
+        };
+
+    if (!FindParities) return;
+    // The null space of the parity equations over GF(2)
+    std::vector<boost::uint64_t> B(ParityRows.begin(), ParityRows.end());
+    std::vector<int> parity_pivots;
+    size_t row = 0;
+    for (ParticleIndex col = 0; col < IndexSize && row < B.size(); ++col) {
+        boost::uint64_t bit = boost::uint64_t(1) << col;
+        size_t p = row;
+        while (p < B.size() && !(B[p] & bit)) ++p;
+        if (p == B.size()) continue;
+        std::swap(B[row], B[p]);
+        for (size_t k = 0; k < B.size(); ++k) if (k != row && (B[k] & bit)) B[k] ^= B[row];
+        parity_pivots.push_back(col);
+        ++row;
+        };
+    std::vector<bool> is_parity_pivot(IndexSize, false);
+    for (size_t p = 0; p < parity_pivots.size(); ++p) is_parity_pivot[parity_pivots[p]] = true;
+    for (ParticleIndex f = 0; f < IndexSize; ++f) {
+        if (is_parity_pivot[f]) continue;
+        boost::uint64_t v = boost::uint64_t(1) << f;
+        for (size_t p = 0; p < parity_pivots.size(); ++p) if ((B[p] >> f) & 1) v |= boost::uint64_t(1) << parity_pivots[p];
+        if (!Parities.insert(v)) continue;
+        Operator op;
+        for (ParticleIndex i = 0; i < IndexSize; ++i) if ((v >> i) & 1) op += OperatorPresets::n(i);
+        if (!addSymmetry(op, 2)) return;
+        INFO("[ H , (-1)^(" << op << ") ]=0");
+        };
+}
+
 void Symmetrizer::compute(const std::vector<Operator>& integrals_of_motion)
 {
     if (Status>=Computed) return;
@@ -185,6 +381,8 @@ void Symmetrizer::compute(const std::vector<Operator>& integrals_of_motion)
         const Operator& in = integrals_of_motion[i];
         if (checkSymmetry(in)) INFO("[ H ," << in << " ]=0");
     }
+    if (FindAbelianSymmetries) findAbelianSymmetries();
+    if (FindPermutations) findPermutations();
 
     Status = Computed;
 }
@@ -211,11 +409,112 @@ void Symmetrizer::compute(bool ignore_symmetries)
             Operator op_sz = Pomerol::OperatorPresets::Sz(IndexSize, SpinUpIndices);
             if (this->checkSymmetry(op_sz)) INFO("[ H ," << op_sz << " ]=0");
         };
+        if (FindAbelianSymmetries) findAbelianSymmetries();
     };
+    if (FindPermutations) findPermutations();
 
     Status = Computed;
 }
 
+namespace {
+/** The largest number of nodes visited by a single search of a permutation. */
+const long MaxPermutationSearchNodes = 1000000;
+
+/** A backtracking search of the index permutations, which map every term of the Hamiltonian onto itself. */
+struct PermutationSearch
+{
+    typedef Operator::monomials_map_t::const_iterator term_iterator;
+    const Operator::monomials_map_t& Terms;
+    ParticleIndex N;
+    /** The terms grouped by their largest index. A term is checked as soon as this index is mapped. */
+    std::vector<std::vector<term_iterator> > TermsByLastIndex;
+    std::vector<ParticleIndex> Image;
+    std::vector<bool> Used;
+    long Nodes;
+
+    PermutationSearch(const Operator::monomials_map_t& Terms, ParticleIndex N) :
+        Terms(Terms), N(N), TermsByLastIndex(N), Image(N), Used(N), Nodes(0)
+    {
+        for (term_iterator it = Terms.begin(); it != Terms.end(); ++it) {
+            if (!it->first.size()) continue;
+            ParticleIndex last = 0;
+            for (size_t n = 0; n < it->first.size(); ++n) last = std::max(last, boost::get<1>(it->first[n]));
+            TermsByLastIndex[last].push_back(it);
+            };
+    };
+
+    /** Checks that the terms with the largest index i are mapped onto the terms of the Hamiltonian. */
+    bool checkTerms(ParticleIndex i) const
+    {
+        for (size_t t = 0; t < TermsByLastIndex[i].size(); ++t) {
+            Operator::monomial_t m = TermsByLastIndex[i][t]->first;
+            for (size_t n = 0; n < m.size(); ++n) boost::get<1>(m[n]) = Image[boost::get<1>(m[n])];
+            // Restore the normal order, the creation and annihilation operators never pass each other
+            int sign = 1;
+            for (size_t x = 1; x < m.size(); ++x)
+                for (size_t y = x; y > 0 && m[y] < m[y-1]; --y) { std::swap(m[y], m[y-1]); sign = -sign; };
+            term_iterator it = Terms.find(m);
+            MelemType coeff = TermsByLastIndex[i][t]->second * RealType(sign);
+            if (it == Terms.end() || std::abs(it->second - coeff) > 1e-12 * std::max(RealType(1), std::abs(coeff))) return false;
+            };
+        return true;
+    };
+
+    /** Maps the indices i..N-1 to the unused ones. */
+    bool search(ParticleIndex i)
+    {
+        if (i == N) return true;
+        if (++Nodes > MaxPermutationSearchNodes) return false;
+        for (ParticleIndex a = 0; a < N; ++a) {
+            if (Used[a]) continue;
+            Image[i] = a;
+            Used[a] = true;
+            if (checkTerms(i) && search(i+1)) return true;
+            Used[a] = false;
+            };
+        return false;
+    };
+
+    /** Looks for a permutation, which leaves the indices below k in place and maps k to a. */
+    bool find(ParticleIndex k, ParticleIndex a)
+    {
+        Used.assign(N, false);
+        Nodes = 0;
+        for (ParticleIndex j = 0; j < k; ++j) { Image[j] = j; Used[j] = true; };
+        Image[k] = a;
+        Used[a] = true;
+        return checkTerms(k) && search(k+1);
+    };
+};
+}
+
+void Symmetrizer::findPermutations()
+{
+    Operator::monomials_map_t Terms(Storage.begin(), Storage.end());
+    PermutationSearch Search(Terms, IndexSize);
+
+    // For every k, the permutations fixing 0..k-1 are found, which map k to every index of its orbit.
+    // Together they generate the whole group of permutations.
+    for (ParticleIndex k = 0; k < IndexSize; ++k) {
+        std::vector<bool> InOrbit(IndexSize, false);
+        InOrbit[k] = true;
+        size_t LevelStart = Permutations.size();
+        for (ParticleIndex a = k + 1; a < IndexSize; ++a) {
+            if (InOrbit[a] || !Search.find(k, a)) continue;
+            Permutations.push_back(DynamicIndexCombination(Search.Image));
+            INFO("Index permutation " << Permutations.back() << " leaves H invariant");
+            // Update the orbit of k with the permutations of this level
+            bool extended = true;
+            while (extended) {
+                extended = false;
+                for (size_t p = LevelStart; p < Permutations.size(); ++p)
+                    for (ParticleIndex i = 0; i < IndexSize; ++i)
+                        if (InOrbit[i] && !InOrbit[Permutations[p].getIndex(i)]) InOrbit[Permutations[p].getIndex(i)] = extended = true;
+                };
+            };
+        };
+}
+
 Symmetrizer::QuantumNumbers Symmetrizer::getQuantumNumbers() const
 {
     return Symmetrizer::QuantumNumbers(NSymmetries);
@@ -224,8 +523,8 @@ Symmetrizer::QuantumNumbers Symmetrizer::getQuantumNumbers() const
 std::ostream& operator<<(std::ostream& output, const Symmetrizer::QuantumNumbers& out)
 {
     output << "[";
-    for (int i=0 ;i<out.amount-1; ++i) output << out.numbers[i] << ",";
-    if ( out.amount ) output << out.numbers[out.amount-1];
+    for (int i=0 ;i<out.amount-1; ++i) output << out.get(i) << ",";
+    if ( out.amount ) output << out.get(out.amount-1);
     output << "]";
     return output;
 }
@@ -15,7 +15,10 @@ TwoParticleGF::TwoParticleGF(const StatesClassification& S, const Hamiltonian& H
     parts(0), Vanishing(true),
     ReduceResonanceTolerance (1e-8),
     CoefficientTolerance (1e-16),
-    MultiTermCoefficientTolerance (1e-5)
+    MultiTermCoefficientTolerance (1e-5),
+    TermsStorage (TreeStorage),
+    ThreadedCompute (false),
+    DistributedTerms (false)
 {
 }
 
@@ -102,6 +105,9 @@ void TwoParticleGF::prepare()
                       (*parts.rbegin())->ReduceResonanceTolerance = ReduceResonanceTolerance;
                       (*parts.rbegin())->CoefficientTolerance = CoefficientTolerance;
                       (*parts.rbegin())->MultiTermCoefficientTolerance = MultiTermCoefficientTolerance;
+                      (*parts.rbegin())->NonResonantTerms.set_storage(TermsStorage);
+                      (*parts.rbegin())->ResonantTerms.set_storage(TermsStorage);
+                      (*parts.rbegin())->ThreadedCompute = ThreadedCompute;
                       }
             }
     }
@@ -118,39 +124,90 @@ bool TwoParticleGF::isVanishing(void) const
 }
 
 
-// An mpi adapter to 1) compute 2pgf terms; 2) convert them to a Matsubara Container; 3) purge terms
-typedef boost::tuple<ComplexType, ComplexType, ComplexType> freq_tuple;
-typedef std::vector<freq_tuple> freq_vec_t;
+void TwoParticleGF::evaluate(const FrequencyBlock& Freqs, ComplexType* out) const
+{
+    std::fill(out, out + Freqs.size(), ComplexType(0));
+    if (Vanishing) return;
+    for(std::vector<TwoParticleGFPart*>::const_iterator iter = parts.begin(); iter != parts.end(); iter++)
+        (*iter)->evaluate(Freqs, out);
+}
+
+void TwoParticleGF::evaluate(const FrequencyGrid& Grid, ComplexType* out) const
+{
+    std::fill(out, out + Grid.size(), ComplexType(0));
+    if (Vanishing) return;
+    for(std::vector<TwoParticleGFPart*>::const_iterator iter = parts.begin(); iter != parts.end(); iter++)
+        (*iter)->evaluate(Grid, out);
+}
+
+void TwoParticleGF::evaluate(const FrequencyBlock& Freqs, ComplexType* out, const boost::mpi::communicator & comm) const
+{
+    std::vector<ComplexType> local(Freqs.size(), 0.0);
+    if (!Vanishing) {
+        // Only the parts computed on this process hold terms
+        for(std::vector<TwoParticleGFPart*>::const_iterator iter = parts.begin(); iter != parts.end(); iter++)
+            if ((*iter)->Status == TwoParticleGFPart::Computed) (*iter)->evaluate(Freqs, &local[0]);
+    }
+    if (local.size()) boost::mpi::all_reduce(comm, &local[0], local.size(), out, std::plus<ComplexType>());
+}
+
+void TwoParticleGF::evaluate(const FrequencyGrid& Grid, ComplexType* out, const boost::mpi::communicator & comm) const
+{
+    std::vector<ComplexType> local(Grid.size(), 0.0);
+    if (!Vanishing) {
+        for(std::vector<TwoParticleGFPart*>::const_iterator iter = parts.begin(); iter != parts.end(); iter++)
+            if ((*iter)->Status == TwoParticleGFPart::Computed) (*iter)->evaluate(Grid, &local[0]);
+    }
+    if (local.size()) boost::mpi::all_reduce(comm, &local[0], local.size(), out, std::plus<ComplexType>());
+}
+
+// An mpi adapter to 1) compute 2pgf terms of one or several parts; 2) convert them to a Matsubara Container; 3) purge terms
 struct ComputeAndClearWrap
 {
     void run(){
-        p->compute();
-        if (fill_) {
-            int wsize = freqs_->size();
-            #ifdef POMEROL_USE_OPENMP
-            #pragma omp parallel for
-            #endif
-            for (int w = 0; w < wsize; ++w) {
-                (*data_)[w] += (*p)(boost::get<0>((*freqs_)[w]), boost::get<1>((*freqs_)[w]), boost::get<2>((*freqs_)[w]));
+        // Several small parts of a job are computed concurrently; a single part may use threads by itself
+        #ifdef POMEROL_USE_OPENMP
+        #pragma omp parallel for schedule(dynamic) if(parts_.size() > 1)
+        #endif
+        for (long i = 0; i < long(parts_.size()); ++i) parts_[i]->compute();
+        for (size_t i = 0; i < parts_.size(); ++i) {
+            TwoParticleGFPart *p = parts_[i];
+            // The numbers of terms are reported after the concurrent loop, so that the lines do not interleave
+            std::cout << "Total " << p->getNumNonResonantTerms() << "+" << p->getNumResonantTerms() << "="
+                      << p->getNumNonResonantTerms() + p->getNumResonantTerms() << " terms" << std::endl << std::flush;
+            if (fill_) {
+                // evaluate() builds the structure-of-arrays form of the terms locally, the part is not frozen
+                if (freqs_) p->evaluate(*freqs_, &(*data_)[0]);
+                if (grid_) p->evaluate(*grid_, &(*data_)[0]);
                 }
-            #ifdef POMEROL_USE_OPENMP
-            #pragma omp barrier
-            #endif
+            if (clear_) p->clear();
             }
-        if (clear_) p->clear();
     };
-    ComputeAndClearWrap(freq_vec_t const* freqs, std::vector<ComplexType> *data,  TwoParticleGFPart *p, bool clear, bool fill, int complexity = 1):
-        freqs_(freqs), data_(data), p(p),clear_(clear), fill_(fill), complexity(complexity){};
-    int complexity;
+    ComputeAndClearWrap(FrequencyBlock const* freqs, FrequencyGrid const* grid, std::vector<ComplexType> *data, bool clear, bool fill):
+        complexity(0), freqs_(freqs), grid_(grid), data_(data), clear_(clear), fill_(fill){};
+    void addPart(TwoParticleGFPart *p, RealType part_complexity) { parts_.push_back(p); complexity += part_complexity; };
+    RealType complexity;
 protected:
-    freq_vec_t const* freqs_;
+    FrequencyBlock const* freqs_;
+    FrequencyGrid const* grid_;
     std::vector<ComplexType>* data_;
-    TwoParticleGFPart *p;
+    std::vector<TwoParticleGFPart*> parts_;
     bool clear_;
     bool fill_;
 };
 
 std::vector<ComplexType> TwoParticleGF::compute(bool clear, std::vector<boost::tuple<ComplexType, ComplexType, ComplexType> > const& freqs, const boost::mpi::communicator & comm)
+{
+    FrequencyBlock Freqs(freqs);
+    return computeParts(clear, &Freqs, NULL, comm);
+}
+
+std::vector<ComplexType> TwoParticleGF::compute(bool clear, const FrequencyGrid& Grid, const boost::mpi::communicator & comm)
+{
+    return computeParts(clear, NULL, &Grid, comm);
+}
+
+std::vector<ComplexType> TwoParticleGF::computeParts(bool clear, const FrequencyBlock* Freqs, const FrequencyGrid* Grid, const boost::mpi::communicator & comm)
 {
     std::vector<ComplexType> m_data;
     if (Status < Prepared) throw (exStatusMismatch());
@@ -158,11 +215,23 @@ std::vector<ComplexType> TwoParticleGF::compute(bool clear, std::vector<boost::t
     if (!Vanishing) {
         // Create a "skeleton" class with pointers to part that can call a compute method
         pMPI::mpi_skel<ComputeAndClearWrap> skel;
-        bool fill_container = freqs.size() > 0;
-        skel.parts.reserve(parts.size());
-        m_data.resize(freqs.size(), 0.0);
-        for (size_t i=0; i<parts.size(); i++) {
-            skel.parts.push_back(ComputeAndClearWrap(&freqs, &m_data, parts[i], clear, fill_container, 1));
+        long data_size = Freqs ? Freqs->size() : Grid->size();
+        bool fill_container = data_size > 0;
+        m_data.resize(data_size, 0.0);
+
+        // Estimate the cost of the parts and bundle the cheap ones, so that the jobs are of comparable size
+        std::vector<RealType> complexity(parts.size());
+        for (size_t i=0; i<parts.size(); i++) complexity[i] = parts[i]->getComplexity();
+        std::vector<std::vector<size_t> > jobs = pMPI::group_jobs(complexity, comm.size());
+
+        std::vector<pMPI::JobId> part_jobs(parts.size());
+        for (size_t j=0; j<jobs.size(); j++) {
+            skel.parts.push_back(ComputeAndClearWrap(Freqs, Grid, &m_data, clear, fill_container));
+            for (size_t i=0; i<jobs[j].size(); i++) {
+                size_t p = jobs[j][i];
+                part_jobs[p] = j;
+                skel.parts.back().addPart(parts[p], complexity[p]);
+                };
             };
         std::map<pMPI::JobId, pMPI::WorkerId> job_map = skel.run(comm, true); // actual running - very costly
         int rank = comm.rank();
@@ -172,13 +241,15 @@ std::vector<ComplexType> TwoParticleGF::compute(bool clear, std::vector<boost::t
         //DEBUG(comm.rank() << getIndex(0) << getIndex(1) << getIndex(2) << getIndex(3) << " Start distributing data");
         comm.barrier();
 
-        std::vector<ComplexType> m_data2(m_data.size(), 0.0);
-        boost::mpi::reduce(comm, &m_data[0], m_data.size(), &m_data2[0], std::plus<ComplexType>(), 0);
-        std::swap(m_data, m_data2);
-        if (!clear) {
+        if (fill_container) {
+            std::vector<ComplexType> m_data2(m_data.size(), 0.0);
+            boost::mpi::reduce(comm, &m_data[0], m_data.size(), &m_data2[0], std::plus<ComplexType>(), 0);
+            std::swap(m_data, m_data2);
+        }
+        if (!clear && !DistributedTerms) {
             for (size_t p = 0; p<parts.size(); p++) {
-                boost::mpi::broadcast(comm, parts[p]->NonResonantTerms, job_map[p]);
-                boost::mpi::broadcast(comm, parts[p]->ResonantTerms, job_map[p]);
+                boost::mpi::broadcast(comm, parts[p]->NonResonantTerms, job_map[part_jobs[p]]);
+                boost::mpi::broadcast(comm, parts[p]->ResonantTerms, job_map[part_jobs[p]]);
                 parts[p]->Status = TwoParticleGFPart::Computed;
             };
             comm.barrier();
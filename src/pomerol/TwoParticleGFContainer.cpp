@@ -31,7 +31,10 @@ TwoParticleGFContainer::TwoParticleGFContainer(const IndexClassification& IndexI
     S(S),H(H),DM(DM), Operators(Operators),
     ReduceResonanceTolerance (1e-8),//1e-16),
     CoefficientTolerance (1e-16),//1e-16),
-    MultiTermCoefficientTolerance (1e-5)//1e-5),
+    MultiTermCoefficientTolerance (1e-5),//1e-5),
+    TermsStorage (TreeStorage),
+    ThreadedCompute (false),
+    DistributedTerms (false)
 {}
 
 void TwoParticleGFContainer::prepareAll(const std::set<IndexCombination4>& InitialIndices)
@@ -42,6 +45,9 @@ void TwoParticleGFContainer::prepareAll(const std::set<IndexCombination4>& Initi
         static_cast<TwoParticleGF&>(iter->second).ReduceResonanceTolerance = ReduceResonanceTolerance;
         static_cast<TwoParticleGF&>(iter->second).CoefficientTolerance = CoefficientTolerance;
         static_cast<TwoParticleGF&>(iter->second).MultiTermCoefficientTolerance = MultiTermCoefficientTolerance;
+        static_cast<TwoParticleGF&>(iter->second).TermsStorage = TermsStorage;
+        static_cast<TwoParticleGF&>(iter->second).ThreadedCompute = ThreadedCompute;
+        static_cast<TwoParticleGF&>(iter->second).DistributedTerms = DistributedTerms;
         static_cast<TwoParticleGF&>(iter->second).prepare();
        };
 }
@@ -111,19 +117,23 @@ std::map<IndexCombination4,std::vector<ComplexType> > TwoParticleGFContainer::co
     for(std::map<IndexCombination4, boost::shared_ptr<TwoParticleGF> >::iterator iter = NonTrivialElements.begin(); iter != NonTrivialElements.end(); iter++, comp++) {
         int sender = color_roots[elem_colors[comp]];
         TwoParticleGF& chi = *((iter)->second);
-        for (size_t p = 0; p<chi.parts.size(); p++) {
-        //    if (comm.rank() == sender) INFO("P" << comm.rank() << " 2pgf " << p << " " << chi.parts[p]->NonResonantTerms.size());
-            boost::mpi::broadcast(comm, chi.parts[p]->NonResonantTerms, sender);
-            boost::mpi::broadcast(comm, chi.parts[p]->ResonantTerms, sender);
-            std::vector<ComplexType> freq_data;
-            if (comm.rank() == sender) freq_data = storage[iter->first];
-            boost::mpi::broadcast(comm, freq_data, sender);
-            out[iter->first] = freq_data;
-
-            if (comm.rank() != sender) {
-                chi.setStatus(TwoParticleGF::Computed);
-                 };
+        // The terms are only needed if they are kept, and are left with their owners in the distributed mode
+        if (!clearTerms && !DistributedTerms) {
+            for (size_t p = 0; p<chi.parts.size(); p++) {
+            //    if (comm.rank() == sender) INFO("P" << comm.rank() << " 2pgf " << p << " " << chi.parts[p]->NonResonantTerms.size());
+                boost::mpi::broadcast(comm, chi.parts[p]->NonResonantTerms, sender);
+                boost::mpi::broadcast(comm, chi.parts[p]->ResonantTerms, sender);
+                chi.parts[p]->Status = TwoParticleGFPart::Computed;
+                };
             };
+        std::vector<ComplexType> freq_data;
+        if (comm.rank() == sender) freq_data = storage[iter->first];
+        boost::mpi::broadcast(comm, freq_data, sender);
+        out[iter->first] = freq_data;
+
+        if (comm.rank() != sender) {
+            chi.setStatus(TwoParticleGF::Computed);
+             };
     }
     comm.barrier();
     if (!comm.rank()) INFO("done.");
@@ -1,4 +1,9 @@
 #include "pomerol/TwoParticleGFPart.h"
+#include <iterator>
+
+#if defined(POMEROL_USE_OPENMP) && (_OPENMP >= 201307)
+#define POMEROL_OPENMP_SIMD
+#endif
 
 namespace Pomerol{
 
@@ -20,47 +25,102 @@ inline bool chaseIndices(RowMajorMatrixType::InnerIterator& index1_iter,
 }
 
 //
-// TwoParticleGFPart::NonResonantTerm
+// FrequencyBlock
 //
-inline
-TwoParticleGFPart::NonResonantTerm::NonResonantTerm(ComplexType Coeff, RealType P1, RealType P2, RealType P3, bool isz4) :
-Coeff(Coeff), isz4(isz4)
+FrequencyBlock::FrequencyBlock(const std::vector<boost::tuple<ComplexType, ComplexType, ComplexType> >& freqs) :
+    z1(freqs.size()), z2(freqs.size()), z3(freqs.size())
 {
-    Poles[0] = P1; Poles[1] = P2; Poles[2] = P3; Weight=1;
+    for (size_t w = 0; w < freqs.size(); ++w) {
+        z1(w) = boost::get<0>(freqs[w]);
+        z2(w) = boost::get<1>(freqs[w]);
+        z3(w) = boost::get<2>(freqs[w]);
+    }
 }
 
-inline
-TwoParticleGFPart::NonResonantTerm& TwoParticleGFPart::NonResonantTerm::operator+=(
-                    const NonResonantTerm& AnotherTerm)
+FrequencyBlock::FrequencyBlock(const FrequencyGrid& Grid, RealType beta) :
+    z1(Grid.size()), z2(Grid.size()), z3(Grid.size())
 {
-    long combinedWeight=Weight + AnotherTerm.Weight;
-    for (unsigned short p=0; p<3; ++p) Poles[p]= (Weight*Poles[p] + AnotherTerm.Weight*AnotherTerm.Poles[p])/combinedWeight;
-    Weight=combinedWeight;
-    Coeff += AnotherTerm.Coeff;
-    return *this;
+    long w = 0;
+    for (long m = Grid.BosonicMin; m <= Grid.BosonicMax; ++m)
+    for (long n3 = Grid.FermionicMin; n3 <= Grid.FermionicMax; ++n3)
+    for (long n2 = Grid.FermionicMin; n2 <= Grid.FermionicMax; ++n2, ++w) {
+        z1(w) = I*M_PI*RealType(2*m + 2*n3 + 1)/beta;
+        z2(w) = I*M_PI*RealType(2*n2 + 1)/beta;
+        z3(w) = I*M_PI*RealType(2*n3 + 1)/beta;
+    }
 }
 
 //
-// TwoParticleGFPart::ResonantTerm
+// Factorized evaluation on a FrequencyGrid
 //
-inline
-TwoParticleGFPart::ResonantTerm::ResonantTerm(ComplexType ResCoeff, ComplexType NonResCoeff,
-                                              RealType P1, RealType P2, RealType P3, bool isz1z2):
-ResCoeff(ResCoeff), NonResCoeff(NonResCoeff), isz1z2(isz1z2)
-{
-    Poles[0] = P1; Poles[1] = P2; Poles[2] = P3; Weight=1;
-}
 
-inline
-TwoParticleGFPart::ResonantTerm& TwoParticleGFPart::ResonantTerm::operator+=(
-                const ResonantTerm& AnotherTerm)
+/** An odd or even Matsubara number \f$ K \f$ (\f$ z = i\pi K/\beta \f$) written as a linear form
+ * of the grid indices: \f$ K = \mathrm{Bosonic}\cdot m + \mathrm{Fermionic2}\cdot n_2 + \mathrm{Fermionic3}\cdot n_3 + \mathrm{Shift} \f$.
+ */
+struct MatsubaraForm {
+    long Bosonic, Fermionic2, Fermionic3, Shift;
+    MatsubaraForm(long Bosonic, long Fermionic2, long Fermionic3, long Shift) :
+        Bosonic(Bosonic), Fermionic2(Fermionic2), Fermionic3(Fermionic3), Shift(Shift) {}
+    MatsubaraForm operator+(const MatsubaraForm& rhs) const
+    {
+        return MatsubaraForm(Bosonic + rhs.Bosonic, Fermionic2 + rhs.Fermionic2, Fermionic3 + rhs.Fermionic3, Shift + rhs.Shift);
+    }
+};
+
+/** Values of a single factor of a term tabulated for a fixed bosonic frequency.
+ * The factor for the grid point \f$ (n_2,n_3) \f$ is stored at Offset + Stride2*(n_2-n_{min}) + Stride3*(n_3-n_{min}).
+ */
+struct MatsubaraFactorTable {
+    long Stride2, Stride3, Offset;
+    /** The Matsubara number of the first entry; the entries are spaced by 2. */
+    long FirstNumber;
+    std::vector<ComplexType> Values;
+
+    MatsubaraFactorTable(const MatsubaraForm& Form, long m, const FrequencyGrid& Grid) :
+        Stride2(Form.Fermionic2/2), Stride3(Form.Fermionic3/2)
+    {
+        long Last = Grid.getFermionicSize() - 1;
+        Offset = std::max(-Stride2, 0L)*Last + std::max(-Stride3, 0L)*Last;
+        FirstNumber = Form.Bosonic*m + Form.Shift + (Form.Fermionic2 + Form.Fermionic3)*Grid.FermionicMin - 2*Offset;
+        Values.resize((std::abs(Stride2) + std::abs(Stride3))*Last + 1);
+    }
+
+    /** Tabulates \f$ \mathrm{Coeff}/(z-P) \f$. */
+    void fill(ComplexType MatsubaraSpacing, ComplexType Coeff, RealType P)
+    {
+        for (size_t t = 0; t < Values.size(); ++t)
+            Values[t] = Coeff / (MatsubaraSpacing*RealType(FirstNumber + 2*long(t)) - P);
+    }
+
+    /** Tabulates the resonant factor of a ResonantTerm. */
+    void fill(ComplexType MatsubaraSpacing, ComplexType ResCoeff, ComplexType NonResCoeff, RealType P, RealType KroneckerSymbolTolerance)
+    {
+        for (size_t t = 0; t < Values.size(); ++t) {
+            ComplexType Diff = MatsubaraSpacing*RealType(FirstNumber + 2*long(t)) - P;
+            Values[t] = abs(Diff) < KroneckerSymbolTolerance ? ResCoeff : NonResCoeff / Diff;
+        }
+    }
+
+    const ComplexType* row(long n3) const { return &Values[0] + Offset + Stride3*n3; }
+};
+
+/** Adds the products of three tabulated factors to a bosonic slice of the grid. */
+static void addFactorProducts(const MatsubaraFactorTable& A, const MatsubaraFactorTable& B, const MatsubaraFactorTable& C,
+                              long FermionicSize, ComplexType* Slice)
 {
-    long combinedWeight=Weight + AnotherTerm.Weight;
-    for (unsigned short p=0; p<3; ++p) Poles[p]= (Weight*Poles[p] + AnotherTerm.Weight*AnotherTerm.Poles[p])/combinedWeight;
-    Weight=combinedWeight;
-    ResCoeff += AnotherTerm.ResCoeff;
-    NonResCoeff += AnotherTerm.NonResCoeff;
-    return *this;
+    for (long n3 = 0; n3 < FermionicSize; ++n3) {
+        const ComplexType *a = A.row(n3), *b = B.row(n3), *c = C.row(n3);
+        RealType* out = reinterpret_cast<RealType*>(Slice + n3*FermionicSize);
+        #ifdef POMEROL_OPENMP_SIMD
+        #pragma omp simd
+        #endif
+        for (long n2 = 0; n2 < FermionicSize; ++n2) {
+            const ComplexType &x = a[A.Stride2*n2], &y = b[B.Stride2*n2], &z = c[C.Stride2*n2];
+            RealType xyr = real(x)*real(y) - imag(x)*imag(y), xyi = real(x)*imag(y) + imag(x)*real(y);
+            out[2*n2] += xyr*real(z) - xyi*imag(z);
+            out[2*n2+1] += xyr*imag(z) + xyi*real(z);
+        }
+    }
 }
 
 //
@@ -82,6 +142,8 @@ TwoParticleGFPart::TwoParticleGFPart(
     Hpart1(Hpart1), Hpart2(Hpart2), Hpart3(Hpart3), Hpart4(Hpart4),
     DMpart1(DMpart1), DMpart2(DMpart2), DMpart3(DMpart3), DMpart4(DMpart4),
     Permutation(Permutation),
+    Frozen(false),
+    ThreadedCompute(false),
     ReduceResonanceTolerance(1e-8),
     CoefficientTolerance (1e-16),
     MultiTermCoefficientTolerance (1e-5)
@@ -91,7 +153,51 @@ void TwoParticleGFPart::compute()
 {
     NonResonantTerms.clear();
     ResonantTerms.clear();
+    unfreeze();
+
+    InnerQuantumState index1Max = CX4.getColMajorValue().outerSize(); // One can not make a cutoff in external index for evaluating 2PGF
+
+    if (ThreadedCompute) {
+        // Empty lists with the same comparison and storage settings, copied by every thread.
+        // They must be taken before any thread starts merging its terms into the shared lists.
+        const TermList<NonResonantTerm> EmptyNonResonantTerms(NonResonantTerms);
+        const TermList<ResonantTerm> EmptyResonantTerms(ResonantTerms);
+        #ifdef POMEROL_USE_OPENMP
+        #pragma omp parallel
+        #endif
+        {
+            TermList<NonResonantTerm> LocalNonResonantTerms(EmptyNonResonantTerms);
+            TermList<ResonantTerm> LocalResonantTerms(EmptyResonantTerms);
+            #ifdef POMEROL_USE_OPENMP
+            #pragma omp for schedule(dynamic) nowait
+            #endif
+            for(long index1=0; index1<long(index1Max); ++index1)
+                computeTerms(index1, LocalNonResonantTerms, LocalResonantTerms);
+            #ifdef POMEROL_USE_OPENMP
+            #pragma omp critical
+            #endif
+            {
+                NonResonantTerms.add_terms(LocalNonResonantTerms);
+                ResonantTerms.add_terms(LocalResonantTerms);
+            }
+        }
+    } else {
+        for(InnerQuantumState index1=0; index1<index1Max; ++index1)
+            computeTerms(index1, NonResonantTerms, ResonantTerms);
+    }
 
+    NonResonantTerms.reduce();
+    ResonantTerms.reduce();
+
+    assert(NonResonantTerms.check_terms());
+    assert(ResonantTerms.check_terms());
+
+    Status = Computed;
+}
+
+void TwoParticleGFPart::computeTerms(InnerQuantumState index1,
+                                     TermList<NonResonantTerm>& NonResonant, TermList<ResonantTerm>& Resonant) const
+{
     RealType beta = DMpart1.beta;
     // I don't have any pen now, so I'm writing here:
     // <1 | O1 | 2> <2 | O2 | 3> <3 | O3 |4> <4| CX4 |1>
@@ -102,16 +208,12 @@ void TwoParticleGFPart::compute()
     const RowMajorMatrixType& O3matrix = O3.getRowMajorValue();
     const ColMajorMatrixType& CX4matrix = CX4.getColMajorValue();
 
-    InnerQuantumState index1;
-    InnerQuantumState index1Max = CX4matrix.outerSize(); // One can not make a cutoff in external index for evaluating 2PGF
-
     InnerQuantumState index3;
     InnerQuantumState index3Max = O2matrix.outerSize();
 
     std::vector<InnerQuantumState> Index4List;
-    Index4List.reserve(index1Max*index3Max);
+    Index4List.reserve(CX4matrix.innerSize());
 
-    for(index1=0; index1<index1Max; ++index1)
     for(index3=0; index3<index3Max; ++index3){
         ColMajorMatrixType::InnerIterator index4bra_iter(CX4matrix,index1);
         RowMajorMatrixType::InnerIterator index4ket_iter(O3matrix,index3);
@@ -153,7 +255,7 @@ void TwoParticleGFPart::compute()
 
                             MatrixElement *= Permutation.sign;
 
-                            addMultiterm(MatrixElement,beta,E1,E2,E3,E4,weight1,weight2,weight3,weight4);
+                            addMultiterm(MatrixElement,beta,E1,E2,E3,E4,weight1,weight2,weight3,weight4,NonResonant,Resonant);
                         }
                     }
                     ++index2bra_iter;
@@ -163,19 +265,13 @@ void TwoParticleGFPart::compute()
         };
     }
 
-    std::cout << "Total " << NonResonantTerms.size() << "+" << ResonantTerms.size() << "="
-              << NonResonantTerms.size() + ResonantTerms.size() << " terms" << std::endl << std::flush;
-
-    assert(NonResonantTerms.check_terms());
-    assert(ResonantTerms.check_terms());
-
-    Status = Computed;
 }
 
 inline
 void TwoParticleGFPart::addMultiterm(ComplexType Coeff, RealType beta,
                       RealType Ei, RealType Ej, RealType Ek, RealType El,
-                      RealType Wi, RealType Wj, RealType Wk, RealType Wl)
+                      RealType Wi, RealType Wj, RealType Wk, RealType Wl,
+                      TermList<NonResonantTerm>& NonResonant, TermList<ResonantTerm>& Resonant) const
 {
     RealType P1 = Ej - Ei;
     RealType P2 = Ek - Ej;
@@ -184,23 +280,23 @@ void TwoParticleGFPart::addMultiterm(ComplexType Coeff, RealType beta,
     // Non-resonant part of the multiterm
     ComplexType CoeffZ2 = -Coeff*(Wj + Wk);
     if(abs(CoeffZ2) > CoefficientTolerance)
-        NonResonantTerms.add_term(
+        NonResonant.add_term(
             NonResonantTerm(CoeffZ2,P1,P2,P3,false));
     ComplexType CoeffZ4 = Coeff*(Wi + Wl);
     if(abs(CoeffZ4) > CoefficientTolerance)
-        NonResonantTerms.add_term(
+        NonResonant.add_term(
             NonResonantTerm(CoeffZ4,P1,P2,P3,true));
 
     // Resonant part of the multiterm
     ComplexType CoeffZ1Z2Res = Coeff*beta*Wi;
     ComplexType CoeffZ1Z2NonRes = Coeff*(Wk - Wi);
     if(abs(CoeffZ1Z2Res) > CoefficientTolerance || abs(CoeffZ1Z2NonRes) > CoefficientTolerance)
-        ResonantTerms.add_term(
+        Resonant.add_term(
             ResonantTerm(CoeffZ1Z2Res,CoeffZ1Z2NonRes,P1,P2,P3,true));
     ComplexType CoeffZ2Z3Res = -Coeff*beta*Wj;
     ComplexType CoeffZ2Z3NonRes = Coeff*(Wj - Wl);
     if(abs(CoeffZ2Z3Res) > CoefficientTolerance || abs(CoeffZ2Z3NonRes) > CoefficientTolerance)
-        ResonantTerms.add_term(
+        Resonant.add_term(
             ResonantTerm(CoeffZ2Z3Res,CoeffZ2Z3NonRes,P1,P2,P3,false));
 }
 
@@ -219,6 +315,22 @@ const Permutation3& TwoParticleGFPart::getPermutation() const
     return Permutation;
 }
 
+RealType TwoParticleGFPart::getComplexity() const
+{
+    const RowMajorMatrixType& O1matrix = O1.getRowMajorValue();
+    const ColMajorMatrixType& O2matrix = O2.getColMajorValue();
+    const RowMajorMatrixType& O3matrix = O3.getRowMajorValue();
+    const ColMajorMatrixType& CX4matrix = CX4.getColMajorValue();
+
+    // <1 | O1 | 2> <2 | O2 | 3> <3 | O3 |4> <4| CX4 |1>
+    RealType N1 = O1matrix.rows(), N2 = O2matrix.rows(), N3 = O3matrix.rows(), N4 = CX4matrix.rows();
+    if (N1*N2*N3*N4 == 0) return 0;
+
+    RealType NumberOfMultiterms = RealType(O1matrix.nonZeros()) * RealType(O2matrix.nonZeros()) *
+                                  RealType(O3matrix.nonZeros()) * RealType(CX4matrix.nonZeros()) / (N1*N2*N3*N4);
+    return N1*N3 + NumberOfMultiterms;
+}
+
 ComplexType TwoParticleGFPart::operator()(long MatsubaraNumber1, long MatsubaraNumber2, long MatsubaraNumber3) const
 {
     long MatsubaraNumberOdd1 = 2*MatsubaraNumber1 + 1;
@@ -241,9 +353,320 @@ ComplexType TwoParticleGFPart::operator()(ComplexType z1, ComplexType z2, Comple
         throw std::logic_error("2PGFPart : Calling operator() on uncomputed container, did you purge all the terms when called compute()");
     }
 
+    if (Frozen) {
+        return sumTerms(FrozenNonResonantTerms[0], z1, z2, z3) +
+               sumTerms(FrozenNonResonantTerms[1], z1, z1 + z2 + z3, z3) +
+               sumTerms(FrozenResonantTerms[0], z1, z2 + z3, z3, ReduceResonanceTolerance) +
+               sumTerms(FrozenResonantTerms[1], z1, z1 + z2, z3, ReduceResonanceTolerance);
+    }
+
     return NonResonantTerms(z1, z2, z3) + ResonantTerms(z1, z2, z3, ReduceResonanceTolerance);
 }
 
+//
+// Frozen terms
+//
+void TwoParticleGFPart::NonResonantArrays::resize(long Size)
+{
+    CoeffRe.resize(Size); CoeffIm.resize(Size);
+    P1.resize(Size); PMid.resize(Size); P3.resize(Size);
+}
+
+void TwoParticleGFPart::ResonantArrays::resize(long Size)
+{
+    ResCoeffRe.resize(Size); ResCoeffIm.resize(Size);
+    NonResCoeffRe.resize(Size); NonResCoeffIm.resize(Size);
+    P1.resize(Size); PMid.resize(Size); P3.resize(Size);
+}
+
+void TwoParticleGFPart::fillArrays(NonResonantArrays* NonResonant, ResonantArrays* Resonant) const
+{
+    std::vector<NonResonantTerm> NRTerms;
+    NRTerms.reserve(NonResonantTerms.size());
+    NonResonantTerms.copy_terms(std::back_inserter(NRTerms));
+
+    long NRSizes[2] = {0, 0};
+    for (std::vector<NonResonantTerm>::const_iterator it = NRTerms.begin(); it != NRTerms.end(); ++it) ++NRSizes[it->isz4];
+    for (int n = 0; n < 2; ++n) { NonResonant[n].resize(NRSizes[n]); NRSizes[n] = 0; }
+    for (std::vector<NonResonantTerm>::const_iterator it = NRTerms.begin(); it != NRTerms.end(); ++it) {
+        NonResonantArrays& A = NonResonant[it->isz4];
+        long n = NRSizes[it->isz4]++;
+        A.CoeffRe(n) = real(it->Coeff);
+        A.CoeffIm(n) = imag(it->Coeff);
+        A.P1(n) = it->Poles[0];
+        A.PMid(n) = it->isz4 ? it->Poles[0] + it->Poles[1] + it->Poles[2] : it->Poles[1];
+        A.P3(n) = it->Poles[2];
+    }
+    std::vector<NonResonantTerm>().swap(NRTerms);
+
+    std::vector<ResonantTerm> RTerms;
+    RTerms.reserve(ResonantTerms.size());
+    ResonantTerms.copy_terms(std::back_inserter(RTerms));
+
+    long RSizes[2] = {0, 0};
+    for (std::vector<ResonantTerm>::const_iterator it = RTerms.begin(); it != RTerms.end(); ++it) ++RSizes[it->isz1z2];
+    for (int n = 0; n < 2; ++n) { Resonant[n].resize(RSizes[n]); RSizes[n] = 0; }
+    for (std::vector<ResonantTerm>::const_iterator it = RTerms.begin(); it != RTerms.end(); ++it) {
+        ResonantArrays& A = Resonant[it->isz1z2];
+        long n = RSizes[it->isz1z2]++;
+        A.ResCoeffRe(n) = real(it->ResCoeff);
+        A.ResCoeffIm(n) = imag(it->ResCoeff);
+        A.NonResCoeffRe(n) = real(it->NonResCoeff);
+        A.NonResCoeffIm(n) = imag(it->NonResCoeff);
+        A.P1(n) = it->Poles[0];
+        A.PMid(n) = it->isz1z2 ? it->Poles[0] + it->Poles[1] : it->Poles[1] + it->Poles[2];
+        A.P3(n) = it->Poles[2];
+    }
+}
+
+void TwoParticleGFPart::freeze()
+{
+    if (Status != Computed) {
+        throw std::logic_error("2PGFPart : Calling freeze() on uncomputed container");
+    }
+    fillArrays(FrozenNonResonantTerms, FrozenResonantTerms);
+    Frozen = true;
+}
+
+void TwoParticleGFPart::unfreeze()
+{
+    for (int n = 0; n < 2; ++n) {
+        FrozenNonResonantTerms[n].resize(0);
+        FrozenResonantTerms[n].resize(0);
+    }
+    Frozen = false;
+}
+
+bool TwoParticleGFPart::isFrozen() const
+{
+    return Frozen;
+}
+
+// The kernels below are written in real arithmetic with no branches in the loop bodies,
+// so that the compiler can vectorize them. Division by a product D of complex factors
+// is done as a multiplication by conj(D)/|D|^2.
+ComplexType TwoParticleGFPart::sumTerms(const NonResonantArrays& Terms, ComplexType z1, ComplexType zMid, ComplexType z3)
+{
+    const RealType x1 = real(z1), y1 = imag(z1);
+    const RealType xm = real(zMid), ym = imag(zMid);
+    const RealType x3 = real(z3), y3 = imag(z3);
+    const RealType *CoeffRe = Terms.CoeffRe.data(), *CoeffIm = Terms.CoeffIm.data();
+    const RealType *P1 = Terms.P1.data(), *PMid = Terms.PMid.data(), *P3 = Terms.P3.data();
+    const long Size = Terms.P1.size();
+
+    RealType Re = 0, Im = 0;
+    #ifdef POMEROL_OPENMP_SIMD
+    #pragma omp simd reduction(+:Re,Im)
+    #endif
+    for (long n = 0; n < Size; ++n) {
+        RealType a1 = x1 - P1[n], am = xm - PMid[n], a3 = x3 - P3[n];
+        RealType dr = a1*am - y1*ym, di = a1*ym + y1*am;
+        RealType er = dr*a3 - di*y3, ei = dr*y3 + di*a3;
+        RealType inv = 1.0/(er*er + ei*ei);
+        Re += (CoeffRe[n]*er + CoeffIm[n]*ei)*inv;
+        Im += (CoeffIm[n]*er - CoeffRe[n]*ei)*inv;
+    }
+    return ComplexType(Re, Im);
+}
+
+ComplexType TwoParticleGFPart::sumTerms(const ResonantArrays& Terms, ComplexType z1, ComplexType zMid, ComplexType z3, RealType KroneckerSymbolTolerance)
+{
+    const RealType x1 = real(z1), y1 = imag(z1);
+    const RealType xm = real(zMid), ym = imag(zMid);
+    const RealType x3 = real(z3), y3 = imag(z3);
+    const RealType Tolerance2 = KroneckerSymbolTolerance*KroneckerSymbolTolerance;
+    const RealType *ResCoeffRe = Terms.ResCoeffRe.data(), *ResCoeffIm = Terms.ResCoeffIm.data();
+    const RealType *NonResCoeffRe = Terms.NonResCoeffRe.data(), *NonResCoeffIm = Terms.NonResCoeffIm.data();
+    const RealType *P1 = Terms.P1.data(), *PMid = Terms.PMid.data(), *P3 = Terms.P3.data();
+    const long Size = Terms.P1.size();
+
+    RealType Re = 0, Im = 0;
+    #ifdef POMEROL_OPENMP_SIMD
+    #pragma omp simd reduction(+:Re,Im)
+    #endif
+    for (long n = 0; n < Size; ++n) {
+        RealType am = xm - PMid[n];
+        RealType DiffNorm = am*am + ym*ym;
+        bool Resonance = DiffNorm < Tolerance2;
+        RealType invDiff = 1.0/(Resonance ? 1.0 : DiffNorm);
+        RealType fr = Resonance ? ResCoeffRe[n] : (NonResCoeffRe[n]*am + NonResCoeffIm[n]*ym)*invDiff;
+        RealType fi = Resonance ? ResCoeffIm[n] : (NonResCoeffIm[n]*am - NonResCoeffRe[n]*ym)*invDiff;
+
+        RealType a1 = x1 - P1[n], a3 = x3 - P3[n];
+        RealType dr = a1*a3 - y1*y3, di = a1*y3 + y1*a3;
+        RealType inv = 1.0/(dr*dr + di*di);
+        Re += (fr*dr + fi*di)*inv;
+        Im += (fi*dr - fr*di)*inv;
+    }
+    return ComplexType(Re, Im);
+}
+
+const long TwoParticleGFPart::FrequencyTileSize;
+
+void TwoParticleGFPart::addTerms(const NonResonantArrays& Terms, long TileLength, const RealType (*Tile)[FrequencyTileSize], RealType* Re, RealType* Im)
+{
+    const RealType *x1 = Tile[0], *y1 = Tile[1], *xm = Tile[2], *ym = Tile[3], *x3 = Tile[4], *y3 = Tile[5];
+    const long Size = Terms.P1.size();
+
+    for (long n = 0; n < Size; ++n) {
+        const RealType CoeffRe = Terms.CoeffRe(n), CoeffIm = Terms.CoeffIm(n);
+        const RealType P1 = Terms.P1(n), PMid = Terms.PMid(n), P3 = Terms.P3(n);
+        #ifdef POMEROL_OPENMP_SIMD
+        #pragma omp simd
+        #endif
+        for (long i = 0; i < TileLength; ++i) {
+            RealType a1 = x1[i] - P1, am = xm[i] - PMid, a3 = x3[i] - P3;
+            RealType dr = a1*am - y1[i]*ym[i], di = a1*ym[i] + y1[i]*am;
+            RealType er = dr*a3 - di*y3[i], ei = dr*y3[i] + di*a3;
+            RealType inv = 1.0/(er*er + ei*ei);
+            Re[i] += (CoeffRe*er + CoeffIm*ei)*inv;
+            Im[i] += (CoeffIm*er - CoeffRe*ei)*inv;
+        }
+    }
+}
+
+void TwoParticleGFPart::addTerms(const ResonantArrays& Terms, long TileLength, const RealType (*Tile)[FrequencyTileSize], RealType KroneckerSymbolTolerance, RealType* Re, RealType* Im)
+{
+    const RealType *x1 = Tile[0], *y1 = Tile[1], *xm = Tile[2], *ym = Tile[3], *x3 = Tile[4], *y3 = Tile[5];
+    const RealType Tolerance2 = KroneckerSymbolTolerance*KroneckerSymbolTolerance;
+    const long Size = Terms.P1.size();
+
+    for (long n = 0; n < Size; ++n) {
+        const RealType ResCoeffRe = Terms.ResCoeffRe(n), ResCoeffIm = Terms.ResCoeffIm(n);
+        const RealType NonResCoeffRe = Terms.NonResCoeffRe(n), NonResCoeffIm = Terms.NonResCoeffIm(n);
+        const RealType P1 = Terms.P1(n), PMid = Terms.PMid(n), P3 = Terms.P3(n);
+        #ifdef POMEROL_OPENMP_SIMD
+        #pragma omp simd
+        #endif
+        for (long i = 0; i < TileLength; ++i) {
+            RealType am = xm[i] - PMid;
+            RealType DiffNorm = am*am + ym[i]*ym[i];
+            bool Resonance = DiffNorm < Tolerance2;
+            RealType invDiff = 1.0/(Resonance ? 1.0 : DiffNorm);
+            RealType fr = Resonance ? ResCoeffRe : (NonResCoeffRe*am + NonResCoeffIm*ym[i])*invDiff;
+            RealType fi = Resonance ? ResCoeffIm : (NonResCoeffIm*am - NonResCoeffRe*ym[i])*invDiff;
+
+            RealType a1 = x1[i] - P1, a3 = x3[i] - P3;
+            RealType dr = a1*a3 - y1[i]*y3[i], di = a1*y3[i] + y1[i]*a3;
+            RealType inv = 1.0/(dr*dr + di*di);
+            Re[i] += (fr*dr + fi*di)*inv;
+            Im[i] += (fi*dr - fr*di)*inv;
+        }
+    }
+}
+
+void TwoParticleGFPart::evaluate(const FrequencyBlock& Freqs, ComplexType* out) const
+{
+    if (Status != Computed) {
+        throw std::logic_error("2PGFPart : Calling evaluate() on uncomputed container, did you purge all the terms when called compute()");
+    }
+
+    NonResonantArrays LocalNonResonantTerms[2];
+    ResonantArrays LocalResonantTerms[2];
+    if (!Frozen) fillArrays(LocalNonResonantTerms, LocalResonantTerms);
+    const NonResonantArrays* NonResonant = Frozen ? FrozenNonResonantTerms : LocalNonResonantTerms;
+    const ResonantArrays* Resonant = Frozen ? FrozenResonantTerms : LocalResonantTerms;
+
+    long NumberOfTiles = (Freqs.size() + FrequencyTileSize - 1) / FrequencyTileSize;
+    #ifdef POMEROL_USE_OPENMP
+    #pragma omp parallel for schedule(dynamic)
+    #endif
+    for (long tile = 0; tile < NumberOfTiles; ++tile) {
+        long Start = tile*FrequencyTileSize;
+        long TileLength = std::min(FrequencyTileSize, Freqs.size() - Start);
+
+        // Permuted frequencies
+        ComplexType z[3][FrequencyTileSize];
+        for (long i = 0; i < TileLength; ++i) {
+            ComplexType Frequencies[3] = { Freqs.z1(Start + i), Freqs.z2(Start + i), -Freqs.z3(Start + i) };
+            for (int k = 0; k < 3; ++k) z[k][i] = Frequencies[Permutation.perm[k]];
+        }
+
+        // Rows of the tile: z1, the middle frequency and z3 (real and imaginary parts)
+        RealType Tile[6][FrequencyTileSize];
+        RealType Re[FrequencyTileSize], Im[FrequencyTileSize];
+        for (long i = 0; i < TileLength; ++i) {
+            Tile[0][i] = real(z[0][i]); Tile[1][i] = imag(z[0][i]);
+            Tile[4][i] = real(z[2][i]); Tile[5][i] = imag(z[2][i]);
+            Re[i] = Im[i] = 0;
+        }
+
+        for (long i = 0; i < TileLength; ++i) { Tile[2][i] = real(z[1][i]); Tile[3][i] = imag(z[1][i]); }
+        addTerms(NonResonant[0], TileLength, Tile, Re, Im);
+        for (long i = 0; i < TileLength; ++i) {
+            ComplexType zMid = z[0][i] + z[1][i] + z[2][i];
+            Tile[2][i] = real(zMid); Tile[3][i] = imag(zMid);
+        }
+        addTerms(NonResonant[1], TileLength, Tile, Re, Im);
+        for (long i = 0; i < TileLength; ++i) {
+            ComplexType zMid = z[1][i] + z[2][i];
+            Tile[2][i] = real(zMid); Tile[3][i] = imag(zMid);
+        }
+        addTerms(Resonant[0], TileLength, Tile, ReduceResonanceTolerance, Re, Im);
+        for (long i = 0; i < TileLength; ++i) {
+            ComplexType zMid = z[0][i] + z[1][i];
+            Tile[2][i] = real(zMid); Tile[3][i] = imag(zMid);
+        }
+        addTerms(Resonant[1], TileLength, Tile, ReduceResonanceTolerance, Re, Im);
+
+        for (long i = 0; i < TileLength; ++i) out[Start + i] += ComplexType(Re[i], Im[i]);
+    }
+}
+
+void TwoParticleGFPart::evaluate(const FrequencyGrid& Grid, ComplexType* out) const
+{
+    if (Status != Computed) {
+        throw std::logic_error("2PGFPart : Calling evaluate() on uncomputed container, did you purge all the terms when called compute()");
+    }
+
+    NonResonantArrays LocalNonResonantTerms[2];
+    ResonantArrays LocalResonantTerms[2];
+    if (!Frozen) fillArrays(LocalNonResonantTerms, LocalResonantTerms);
+    const NonResonantArrays* NonResonant = Frozen ? FrozenNonResonantTerms : LocalNonResonantTerms;
+    const ResonantArrays* Resonant = Frozen ? FrozenResonantTerms : LocalResonantTerms;
+
+    // Matsubara numbers of z1 = W + w3, z2 = w2 and -z3 = -w3
+    MatsubaraForm Frequencies[3] = { MatsubaraForm(2, 0, 2, 1), MatsubaraForm(0, 2, 0, 1), MatsubaraForm(0, 0, -2, -1) };
+    MatsubaraForm Z1 = Frequencies[Permutation.perm[0]];
+    MatsubaraForm Z2 = Frequencies[Permutation.perm[1]];
+    MatsubaraForm Z3 = Frequencies[Permutation.perm[2]];
+    // Middle frequencies of the NonResonant (isz4 = false, true) and Resonant (isz1z2 = false, true) terms
+    MatsubaraForm NonResonantMid[2] = { Z2, Z1 + Z2 + Z3 };
+    MatsubaraForm ResonantMid[2] = { Z2 + Z3, Z1 + Z2 };
+
+    const long FermionicSize = Grid.getFermionicSize();
+    #ifdef POMEROL_USE_OPENMP
+    #pragma omp parallel for schedule(dynamic)
+    #endif
+    for (long mi = 0; mi < Grid.getBosonicSize(); ++mi) {
+        long m = Grid.BosonicMin + mi;
+        ComplexType* Slice = out + mi*FermionicSize*FermionicSize;
+        MatsubaraFactorTable A(Z1, m, Grid), C(Z3, m, Grid);
+
+        for (int k = 0; k < 2; ++k) {
+            const NonResonantArrays& Terms = NonResonant[k];
+            MatsubaraFactorTable B(NonResonantMid[k], m, Grid);
+            for (long n = 0; n < Terms.P1.size(); ++n) {
+                A.fill(MatsubaraSpacing, 1.0, Terms.P1(n));
+                B.fill(MatsubaraSpacing, ComplexType(Terms.CoeffRe(n), Terms.CoeffIm(n)), Terms.PMid(n));
+                C.fill(MatsubaraSpacing, 1.0, Terms.P3(n));
+                addFactorProducts(A, B, C, FermionicSize, Slice);
+            }
+        }
+        for (int k = 0; k < 2; ++k) {
+            const ResonantArrays& Terms = Resonant[k];
+            MatsubaraFactorTable B(ResonantMid[k], m, Grid);
+            for (long n = 0; n < Terms.P1.size(); ++n) {
+                A.fill(MatsubaraSpacing, 1.0, Terms.P1(n));
+                B.fill(MatsubaraSpacing, ComplexType(Terms.ResCoeffRe(n), Terms.ResCoeffIm(n)),
+                       ComplexType(Terms.NonResCoeffRe(n), Terms.NonResCoeffIm(n)), Terms.PMid(n), ReduceResonanceTolerance);
+                C.fill(MatsubaraSpacing, 1.0, Terms.P3(n));
+                addFactorProducts(A, B, C, FermionicSize, Slice);
+            }
+        }
+    }
+}
+
 const TermList<TwoParticleGFPart::ResonantTerm>& TwoParticleGFPart::getResonantTerms() const
 {
     return ResonantTerms;
@@ -258,6 +681,7 @@ void TwoParticleGFPart::clear()
 {
     NonResonantTerms.clear();
     ResonantTerms.clear();
+    unfreeze();
     Status = Constructed;
 }
 
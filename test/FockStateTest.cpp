@@ -0,0 +1,88 @@
+//
+// This file is a part of pomerol - a scientific ED code for obtaining
+// properties of a Hubbard model on a finite-size lattice
+//
+// Copyright (C) 2010-2012 Andrey Antipov <antipov@ct-qmc.org>
+// Copyright (C) 2010-2012 Igor Krivenko <igor@shg.ru>
+//
+// pomerol is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// pomerol is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with pomerol.  If not, see <http://www.gnu.org/licenses/>.
+
+
+/** \file tests/FockStateTest.cpp
+** \brief Test of FixedFockState against boost::dynamic_bitset<>.
+*/
+
+#include "Misc.h"
+#include "Operator.h"
+#include "OperatorPresets.h"
+
+#include<sstream>
+
+using namespace Pomerol;
+
+int main(int argc, char* argv[])
+{
+    boost::mpi::environment env(argc,argv);
+
+    const size_t Size = 6;
+    for (unsigned long v = 0; v < (1ul << Size); ++v) {
+        FixedFockState fixed(Size, v);
+        boost::dynamic_bitset<> dynamic(Size, v);
+        if (fixed.count() != dynamic.count() || fixed.to_ulong() != dynamic.to_ulong()) {
+            ERROR("Count mismatch for " << dynamic);
+            return EXIT_FAILURE;
+        }
+        std::stringstream fixed_str, dynamic_str;
+        fixed_str << fixed;
+        dynamic_str << dynamic;
+        if (fixed_str.str() != dynamic_str.str()) {
+            ERROR("Output mismatch: " << fixed_str.str() << " != " << dynamic_str.str());
+            return EXIT_FAILURE;
+        }
+        for (size_t i = 0; i < Size; ++i) {
+            if (fixed[i] != dynamic[i] || count_below(fixed, i) != count_below(dynamic, i)) {
+                ERROR("Mode " << i << " mismatch for " << dynamic);
+                return EXIT_FAILURE;
+            }
+            FixedFockState f(fixed);
+            boost::dynamic_bitset<> d(dynamic);
+            f[i] = !f[i];
+            d[i] = !d[i];
+            if (f.to_ulong() != d.to_ulong()) {
+                ERROR("Assignment to mode " << i << " mismatch for " << dynamic);
+                return EXIT_FAILURE;
+            }
+        }
+    }
+    if (FixedFockState(Size, 3) == FixedFockState() || !(FixedFockState(Size, 3) < FixedFockState(Size, 4))) {
+        ERROR("Comparison failed");
+        return EXIT_FAILURE;
+    }
+
+    // Fermionic signs: c_1 c^+_3 |0110>, c_2 |0110>
+    Operator op = OperatorPresets::c(1)*OperatorPresets::c_dag(3);
+    std::map<FockState, MelemType> result = op.actRight(FockState(4, 6));
+    if (result.size() != 1 || result.begin()->first != FockState(4, 12) || std::abs(result.begin()->second - 1.0) > 1e-14) {
+        ERROR("c_1 c^+_3 |0110> is wrong");
+        return EXIT_FAILURE;
+    }
+    result = OperatorPresets::c(2).actRight(FockState(4, 6));
+    if (result.size() != 1 || result.begin()->first != FockState(4, 2) || std::abs(result.begin()->second + 1.0) > 1e-14) {
+        ERROR("c_2 |0110> is wrong");
+        return EXIT_FAILURE;
+    }
+
+    INFO("SUCCESS");
+    return EXIT_SUCCESS;
+}
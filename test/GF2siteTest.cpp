@@ -166,5 +166,47 @@ int main(int argc, char* argv[])
         }
     if (!result) return EXIT_FAILURE;
 
+    // Evaluation on a whole grid of Matsubara and real frequencies
+    ComplexVectorType grid(20), G_grid;
+    for(int n = 0; n<10; ++n) grid(n) = I*M_PI*RealType(2*n+1)/beta;
+    for(int n = 10; n<20; ++n) grid(n) = ComplexType(-3.0 + 0.6*(n-10), 0.05);
+    GF.evaluate(grid, G_grid);
+    for(int n = 0; n<20; ++n) {
+        INFO(G_grid(n) << " == " << GF(grid(n)));
+        result = (result && compare(G_grid(n),GF(grid(n))));
+        }
+    if (!result) return EXIT_FAILURE;
+
+    // Imaginary time grid
+    long ntau = 10001;
+    ComplexVectorType G_tau;
+    GF.of_tau_grid(ntau, G_tau);
+    for(long k = 0; k<ntau; k+=ntau/20) {
+        ComplexType G_ref_tau = GF.of_tau(beta*k/(ntau-1));
+        if(std::abs(G_tau(k) - G_ref_tau) > 1e-10) { ERROR(G_tau(k) << " != " << G_ref_tau); return EXIT_FAILURE; }
+        }
+    INFO("G(0) + G(beta) = " << G_tau(0) + G_tau(ntau-1));
+    if(!compare(G_tau(0) + G_tau(ntau-1), -1.0)) return EXIT_FAILURE;
+
+    // Compression of the merged poles with a tolerance on the spectral weight
+    std::vector<RealType> Poles;
+    std::vector<ComplexType> Residues;
+    GF.getTerms(Poles, Residues);
+    RealType TotalWeight = 0;
+    for(size_t n = 0; n<Poles.size(); ++n) {
+        TotalWeight += std::abs(Residues[n]);
+        if(n > 0 && !(Poles[n] - Poles[n-1] >= GF.ReduceResonanceTolerance)) return EXIT_FAILURE;
+        }
+    GreensFunction GF_compressed(S,H,Operators.getAnnihilationOperator(0), Operators.getCreationOperator(0), rho);
+    GF_compressed.SpectralWeightTolerance = 1e-2;
+    GF_compressed.prepare();
+    GF_compressed.compute();
+    std::vector<RealType> CompressedPoles;
+    GF_compressed.getTerms(CompressedPoles, Residues);
+    INFO("Poles: " << Poles.size() << " -> " << CompressedPoles.size() << " after compression");
+    if(!(CompressedPoles.size() < Poles.size())) return EXIT_FAILURE;
+    for(int n = 0; n<10; ++n)
+        if(std::abs(GF_compressed(n) - GF(n)) > GF_compressed.SpectralWeightTolerance*TotalWeight*beta/M_PI) return EXIT_FAILURE;
+
     return EXIT_SUCCESS;
 }
@@ -82,6 +82,7 @@ int main(int argc, char* argv[])
     Storage.prepare();
 
     Symmetrizer Symm(IndexInfo, Storage);
+    Symm.FindPermutations = true;
     Symm.compute();
 
     StatesClassification S(IndexInfo,Symm);
@@ -121,5 +122,20 @@ int main(int argc, char* argv[])
             )
             return EXIT_FAILURE;
 
+    // The spin flip relates the components, which share one Green's function
+    if(Symm.getPermutations().size() != 1) return EXIT_FAILURE;
+    GFContainer G_symm(IndexInfo,S,H,rho,Operators);
+    G_symm.setPermutations(Symm.getPermutations());
+    G_symm.prepareAll(indices);
+    G_symm.computeAll();
+    if(&G_symm(0,0) != &G_symm(1,1) || &G_symm(0,1) != &G_symm(1,0) || &G_symm(0,0) == &G_symm(0,1)) return EXIT_FAILURE;
+
+    for(int n = -100; n<100; ++n)
+        if( !compare(G_symm(0,0)(n),Gref(n,beta)) ||
+            !compare(G_symm(0,1)(n),0.0) ||
+            !compare(G_symm(1,1)(n),Gref(n,beta))
+            )
+            return EXIT_FAILURE;
+
     return EXIT_SUCCESS;
 }
@@ -36,10 +36,84 @@
 #include "StatesClassification.h"
 #include "HamiltonianPart.h"
 #include "Hamiltonian.h"
+#include "DensityMatrix.h"
+#include "FieldOperator.h"
+#include "GreensFunction.h"
 #include <boost/shared_ptr.hpp>
 
 using namespace Pomerol;
 
+/** Checks that the eigenpairs of the sparse blocks within the energy window coincide with those of the dense blocks. */
+bool compareSparse(const StatesClassification& S, const Hamiltonian& HDense, const Hamiltonian& HSparse)
+{
+    INFO("Lowest energy level is " << HSparse.getGroundEnergy() << " (sparse), " << HDense.getGroundEnergy() << " (dense)");
+    if (std::abs(HSparse.getGroundEnergy() - HDense.getGroundEnergy()) > 1e-8) return false;
+    RealType Cutoff = HDense.getGroundEnergy() + HSparse.EnergyWindow;
+    for (BlockNumber b = 0; b < S.NumberOfBlocks(); b++) {
+        const RealVectorType& EDense = HDense.getPart(b).getEigenValues();
+        const RealVectorType& ESparse = HSparse.getPart(b).getEigenValues();
+        long n = 0;
+        while (n < EDense.size() && EDense(n) <= Cutoff) n++;
+        if (ESparse.size() < n) return false;
+        for (long i = 0; i < n; i++) if (std::abs(ESparse(i) - EDense(i)) > 1e-8) return false;
+        // Only the computed eigenvalues are exposed
+        if (ESparse.size() < EDense.size()) {
+            bool thrown = false;
+            try { HSparse.getPart(b).getEigenValue(ESparse.size()); }
+            catch (StatesClassification::exWrongState &e) { thrown = true; };
+            if (!thrown) return false;
+            };
+        // The eigenvectors must diagonalize the dense block
+        const MatrixType& U = HSparse.getPart(b).getMatrix();
+        for (long i = 0; i < n; i++) {
+            RealType overlap = 0;
+            for (long j = 0; j < EDense.size(); j++)
+                if (std::abs(EDense(j) - ESparse(i)) < 1e-8) overlap += std::norm(HDense.getPart(b).getMatrix().col(j).dot(U.col(i)));
+            if (std::abs(overlap - 1) > 1e-8) return false;
+            };
+        };
+    return true;
+}
+
+/** Checks that two classifications of the states coincide, and that every state is found at its place in its block. */
+bool compareClassifications(const StatesClassification& S, const StatesClassification& SScan)
+{
+    if (S.NumberOfBlocks() != SScan.NumberOfBlocks()) return false;
+    for (BlockNumber b = 0; b < S.NumberOfBlocks(); b++) {
+        const std::vector<FockState>& states = S.getFockStates(b);
+        if (states.size() != SScan.getBlockSize(b)) return false;
+        for (InnerQuantumState i = 0; i < states.size(); i++) {
+            QuantumState state = states[i].to_ulong();
+            if (i && states[i-1].to_ulong() >= state) return false;
+            if (SScan.getFockState(b, i).to_ulong() != state) return false;
+            if (S.getBlockNumber(state) != b || S.getInnerState(state) != i || S.getInnerState(b, state) != i) return false;
+            };
+        // Blocks are numbered by their lowest states
+        if (b && S.getFockStates(BlockNumber(b-1))[0].to_ulong() >= states[0].to_ulong()) return false;
+        };
+    return true;
+}
+
+/** Returns the values of the Green's function of the index 0 at the lowest Matsubara frequencies. */
+ComplexVectorType computeGF(const IndexClassification& IndexInfo, const StatesClassification& S, const Hamiltonian& H, RealType beta, long nmax)
+{
+    DensityMatrix rho(S,H,beta);
+    rho.prepare();
+    rho.compute();
+    CreationOperator Cdag(IndexInfo, S, H, 0);
+    Cdag.prepare();
+    Cdag.compute();
+    AnnihilationOperator C(IndexInfo, S, H, 0);
+    C.prepare();
+    C.compute();
+    GreensFunction GF(S,H,C,Cdag,rho);
+    GF.prepare();
+    GF.compute();
+    ComplexVectorType G(nmax);
+    for (long n = 0; n < nmax; n++) G(n) = GF(n);
+    return G;
+}
+
 int main(int argc, char* argv[])
 {
     boost::mpi::environment env(argc,argv);
@@ -75,6 +149,90 @@ int main(int argc, char* argv[])
     RealType E_calc = H.getGroundEnergy();
     INFO("Lowest energy level is " << E_calc);
     if (std::abs(E-E_calc) > 1e-7) return EXIT_FAILURE;
+
+    // Partial diagonalization of the large blocks of a Hubbard ring
+    Lattice L2;
+    const char* labels[] = {"A", "B", "C", "D", "E"};
+    for (size_t i=0; i<4; i++) {
+        L2.addSite(new Lattice::Site(labels[i],1,2));
+        LatticePresets::addCoulombS(&L2, labels[i], 2.0, -1.0);
+        };
+    for (size_t i=0; i<4; i++) LatticePresets::addHopping(&L2, labels[i], labels[(i+1)%4], -1.0);
+
+    IndexClassification IndexInfo2(L2.getSiteMap());
+    IndexInfo2.prepare();
+    IndexHamiltonian Storage2(&L2,IndexInfo2);
+    Storage2.prepare();
+    Symmetrizer Symm2(IndexInfo2, Storage2);
+    Symm2.compute();
+    StatesClassification S2(IndexInfo2,Symm2);
+    S2.compute();
+
+    // N^2 is not linear in the occupation numbers, so the states are classified by a scan of all of them
+    std::vector<ParticleIndex> SpinUpIndices;
+    for (ParticleIndex i=0; i<IndexInfo2.getIndexSize(); ++i) if (IndexInfo2.getInfo(i).Spin == up) SpinUpIndices.push_back(i);
+    Operator N2 = OperatorPresets::N(IndexInfo2.getIndexSize());
+    N2 *= OperatorPresets::N(IndexInfo2.getIndexSize());
+    std::vector<Operator> integrals;
+    integrals.push_back(N2);
+    integrals.push_back(OperatorPresets::Sz(IndexInfo2.getIndexSize(), SpinUpIndices));
+    Symmetrizer SymmScan(IndexInfo2, Storage2);
+    SymmScan.compute(integrals);
+    StatesClassification SScan(IndexInfo2,SymmScan);
+    SScan.compute();
+    if (!compareClassifications(S2, SScan) || !compareClassifications(SScan, S2)) return EXIT_FAILURE;
+
+    Hamiltonian HDense(IndexInfo2, Storage2, S2);
+    HDense.prepare(world);
+    HDense.compute(world);
+    Hamiltonian HSparse(IndexInfo2, Storage2, S2);
+    HSparse.SparseBlockSize = 10;
+    HSparse.EnergyWindow = 2.0;
+    HSparse.prepare(world);
+    HSparse.compute(world);
+
+    if (!compareSparse(S2, HDense, HSparse)) return EXIT_FAILURE;
+
+    // A ring with non-equivalent sites. Many Fock states of a block have the same diagonal element as one of the eigenvalues.
+    Lattice L3;
+    for (size_t i=0; i<5; i++) {
+        L3.addSite(new Lattice::Site(labels[i],1,2));
+        LatticePresets::addCoulombS(&L3, labels[i], 4.0, -2.0+0.1*i);
+        };
+    for (size_t i=0; i<5; i++) LatticePresets::addHopping(&L3, labels[i], labels[(i+1)%5], -1.0);
+
+    IndexClassification IndexInfo3(L3.getSiteMap());
+    IndexInfo3.prepare();
+    IndexHamiltonian Storage3(&L3,IndexInfo3);
+    Storage3.prepare();
+    Symmetrizer Symm3(IndexInfo3, Storage3);
+    Symm3.compute();
+    StatesClassification S3(IndexInfo3,Symm3);
+    S3.compute();
+
+    Hamiltonian HDense3(IndexInfo3, Storage3, S3);
+    HDense3.prepare(world);
+    HDense3.compute(world);
+    Hamiltonian HSparse3(IndexInfo3, Storage3, S3);
+    HSparse3.SparseBlockSize = 20;
+    HSparse3.EnergyWindow = 3.0;
+    HSparse3.prepare(world);
+    HSparse3.compute(world);
+    if (!compareSparse(S3, HDense3, HSparse3)) return EXIT_FAILURE;
+
+    // The window must also contain the intermediate states of the Green's function, not just the thermally populated ones
+    RealType beta = 20.0;
+    ComplexVectorType GDense = computeGF(IndexInfo3, S3, HDense3, beta, 20);
+    Hamiltonian HSparseGF(IndexInfo3, Storage3, S3);
+    HSparseGF.SparseBlockSize = 20;
+    HSparseGF.EnergyWindow = 10.0;
+    HSparseGF.prepare(world);
+    HSparseGF.compute(world);
+    ComplexVectorType GSparse = computeGF(IndexInfo3, S3, HSparseGF, beta, 20);
+    RealType GFError = (GSparse - GDense).cwiseAbs().maxCoeff();
+    INFO("Maximal difference of the Green's functions is " << GFError);
+    if (GFError > 1e-5) return EXIT_FAILURE;
+
     return EXIT_SUCCESS;
 }
 
@@ -34,6 +34,12 @@
 using namespace Pomerol;
 using namespace Pomerol::OperatorPresets;
 
+/** Collects the states and matrix elements emitted by CompiledOperator::actRight. */
+struct CollectStates {
+    std::map<QuantumState, MelemType> States;
+    void operator()(QuantumState bra, MelemType melem) { States[bra] += melem; };
+};
+
 int main(int argc, char* argv[])
 {
   /* Test of Operator::Term*/
@@ -134,6 +140,32 @@ int main(int argc, char* argv[])
 
   /* end of test of Operator::Term */
 
+   // Compare the compiled action with the symbolic one
+   Operator Op3 = 2.0*Cdag(0)*C(1)*Cdag(2)*C(3) + Cdag(3)*C(2)*Cdag(1)*C(0) - 0.5*Cdag(1)*C(1)*Cdag(3)*C(3) + Cdag(2)*C(0) + C(2)*Cdag(0);
+   CompiledOperator Op3Compiled(Op3);
+   for (QuantumState i=0; i<16; i++) {
+       std::map<FockState, MelemType> symbolic = Op3.actRight(FockState(4,i));
+       CollectStates compiled;
+       Op3Compiled.actRight(i, compiled);
+       for (std::map<QuantumState, MelemType>::const_iterator it = compiled.States.begin(); it != compiled.States.end(); ++it) {
+           if (std::abs(it->second) < 1e-14) continue;
+           std::map<FockState, MelemType>::const_iterator s_it = symbolic.find(FockState(4,it->first));
+           if (s_it == symbolic.end() || std::abs(s_it->second - it->second) > 1e-14) return EXIT_FAILURE;
+           symbolic.erase(s_it);
+           };
+       for (std::map<FockState, MelemType>::const_iterator it = symbolic.begin(); it != symbolic.end(); ++it)
+           if (std::abs(it->second) > 1e-14) return EXIT_FAILURE;
+       };
+
+   // Diagonal elements of a linear combination of occupation numbers and of a generic operator
+   Operator Op4 = Cdag(0)*C(0) - 0.5*Cdag(3)*C(3) + 2.0*Cdag(2)*C(2) + 1.5;
+   Operator Op5 = Op4 + Cdag(1)*C(1)*Cdag(2)*C(2);
+   CompiledOperator Op4Compiled(Op4), Op5Compiled(Op5);
+   for (QuantumState i=0; i<16; i++) {
+       if (std::abs(Op4Compiled.getDiagonalElement(i) - Op4.getMatrixElement(FockState(4,i),FockState(4,i))) > 1e-14) return EXIT_FAILURE;
+       if (std::abs(Op5Compiled.getDiagonalElement(i) - Op5.getMatrixElement(FockState(4,i),FockState(4,i))) > 1e-14) return EXIT_FAILURE;
+       };
+
   return EXIT_SUCCESS;
 }
 
@@ -0,0 +1,149 @@
+//
+// This file is a part of pomerol - a scientific ED code for obtaining 
+// properties of a Hubbard model on a finite-size lattice 
+//
+// Copyright (C) 2010-2012 Andrey Antipov <antipov@ct-qmc.org>
+// Copyright (C) 2010-2012 Igor Krivenko <igor@shg.ru>
+//
+// pomerol is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// pomerol is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with pomerol.  If not, see <http://www.gnu.org/licenses/>.
+
+/** \file tests/SymmetrizerTest.cpp
+** \brief Test of the automatic search of the abelian symmetries and the index permutations in the Symmetrizer.
+*/
+
+#include "Misc.h"
+#include "Lattice.h"
+#include "LatticePresets.h"
+#include "Index.h"
+#include "IndexClassification.h"
+#include "Operator.h"
+#include "OperatorPresets.h"
+#include "IndexHamiltonian.h"
+#include "Symmetrizer.h"
+#include "StatesClassification.h"
+#include "HamiltonianPart.h"
+#include "Hamiltonian.h"
+#include "FieldOperatorContainer.h"
+#include "GFContainer.h"
+
+#include <algorithm>
+
+using namespace Pomerol;
+
+struct Result {
+    ParticleIndex NumberOfIndices;
+    std::vector<DynamicIndexCombination> Permutations;
+    std::vector<ParticleIndex> Equivalent;
+    BlockNumber NumberOfBlocks;
+    int NumberOfParities;
+    RealVectorType Eigenvalues;
+    ComplexVectorType G;
+};
+
+/* Two sites with two orbitals each and the Kanamori interaction. The hopping is orbital-diagonal,
+ * so the pair hopping conserves the parities of the orbital occupations. */
+Result solve(bool find_abelian_symmetries, const boost::mpi::communicator& world)
+{
+    Lattice L;
+    L.addSite(new Lattice::Site("A",2,2));
+    L.addSite(new Lattice::Site("B",2,2));
+    LatticePresets::addCoulombP(&L, "A", 4.0, 0.8, -2.0);
+    LatticePresets::addCoulombP(&L, "B", 4.0, 0.8, -2.0);
+    LatticePresets::addHopping(&L, "A", "B", -1.0, 0, 0);
+    LatticePresets::addHopping(&L, "A", "B", -0.5, 1, 1);
+
+    IndexClassification IndexInfo(L.getSiteMap());
+    IndexInfo.prepare();
+
+    IndexHamiltonian Storage(&L,IndexInfo);
+    Storage.prepare();
+
+    Symmetrizer Symm(IndexInfo, Storage);
+    Symm.FindAbelianSymmetries = find_abelian_symmetries;
+    Symm.FindPermutations = true;
+    Symm.compute();
+
+    StatesClassification S(IndexInfo,Symm);
+    S.compute();
+
+    Hamiltonian H(IndexInfo, Storage, S);
+    H.prepare();
+    H.compute(world);
+
+    DensityMatrix rho(S,H,10.0);
+    rho.prepare();
+    rho.compute();
+
+    FieldOperatorContainer Operators(IndexInfo, S, H);
+    Operators.prepareAll();
+    Operators.computeAll();
+
+    ParticleIndex index = IndexInfo.getIndex("A",0,up);
+    GreensFunction GF(S,H,Operators.getAnnihilationOperator(index), Operators.getCreationOperator(index), rho);
+    GF.prepare();
+    GF.compute();
+
+    Result out;
+    out.NumberOfIndices = IndexInfo.getIndexSize();
+    out.Permutations = Symm.getPermutations();
+    // The spin flip and the exchange of the sites are the symmetries of the model, the orbitals are not equivalent
+    out.Equivalent.push_back(IndexInfo.getIndex("A",0,up));
+    out.Equivalent.push_back(IndexInfo.getIndex("A",0,down));
+    out.Equivalent.push_back(IndexInfo.getIndex("B",0,up));
+    out.Equivalent.push_back(IndexInfo.getIndex("B",0,down));
+    out.NumberOfBlocks = S.NumberOfBlocks();
+    out.NumberOfParities = std::count(Symm.getModuli().begin(), Symm.getModuli().end(), 2);
+    out.Eigenvalues = H.getEigenValues();
+    std::sort(out.Eigenvalues.data(), out.Eigenvalues.data() + out.Eigenvalues.size());
+    out.G.resize(10);
+    for (int n = 0; n < 10; ++n) out.G(n) = GF(n);
+    return out;
+}
+
+int main(int argc, char* argv[])
+{
+    boost::mpi::environment env(argc,argv);
+    boost::mpi::communicator world;
+
+    Result plain = solve(false, world);
+    Result split = solve(true, world);
+
+    INFO("Blocks: " << plain.NumberOfBlocks << " -> " << split.NumberOfBlocks << ", parities found: " << split.NumberOfParities);
+    if (plain.NumberOfParities != 0 || split.NumberOfParities == 0) return EXIT_FAILURE;
+    if (!(plain.NumberOfBlocks < split.NumberOfBlocks)) return EXIT_FAILURE;
+
+    // The orbit of an index under the found permutations
+    std::vector<bool> orbit(plain.NumberOfIndices, false);
+    orbit[plain.Equivalent[0]] = true;
+    for (ParticleIndex step = 0; step < plain.NumberOfIndices; ++step)
+        for (size_t p = 0; p < plain.Permutations.size(); ++p)
+            for (ParticleIndex i = 0; i < plain.NumberOfIndices; ++i)
+                if (orbit[i]) orbit[plain.Permutations[p].getIndex(i)] = true;
+    INFO("Found " << plain.Permutations.size() << " generating permutations, the orbit of index " << plain.Equivalent[0]
+         << " has " << std::count(orbit.begin(), orbit.end(), true) << " indices");
+    if (std::count(orbit.begin(), orbit.end(), true) != 4) return EXIT_FAILURE;
+    for (size_t i = 0; i < plain.Equivalent.size(); ++i) if (!orbit[plain.Equivalent[i]]) return EXIT_FAILURE;
+
+    if (plain.Eigenvalues.size() != split.Eigenvalues.size()) return EXIT_FAILURE;
+    RealType ev_diff = (plain.Eigenvalues - split.Eigenvalues).cwiseAbs().maxCoeff();
+    INFO("Maximal difference of the eigenvalues: " << ev_diff);
+    if (ev_diff > 1e-10) return EXIT_FAILURE;
+
+    for (int n = 0; n < 10; ++n) {
+        INFO(plain.G(n) << " == " << split.G(n) << ", difference " << std::abs(plain.G(n) - split.G(n)));
+        if (std::abs(plain.G(n) - split.G(n)) > 1e-8) return EXIT_FAILURE;
+        };
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,124 @@
+//
+// This file is a part of pomerol - a scientific ED code for obtaining
+// properties of a Hubbard model on a finite-size lattice
+//
+// Copyright (C) 2010-2012 Andrey Antipov <antipov@ct-qmc.org>
+// Copyright (C) 2010-2012 Igor Krivenko <igor@shg.ru>
+//
+// pomerol is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// pomerol is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with pomerol.  If not, see <http://www.gnu.org/licenses/>.
+
+/** \file tests/TermListTest.cpp
+** \brief Test of the TermList storage layouts.
+*/
+
+#include "Misc.h"
+#include "TwoParticleGFPart.h"
+
+#include<cstdlib>
+
+using namespace Pomerol;
+
+typedef TwoParticleGFPart::NonResonantTerm NRTerm;
+typedef TwoParticleGFPart::ResonantTerm RTerm;
+
+// A pole from a small set of levels with a noise well below the tolerance
+RealType random_pole()
+{
+    return 0.25*(rand() % 8) + 1e-11*(RealType(rand())/RAND_MAX);
+}
+
+ComplexType random_coeff()
+{
+    return ComplexType(RealType(rand())/RAND_MAX - 0.5, RealType(rand())/RAND_MAX - 0.5);
+}
+
+bool compare(ComplexType a, ComplexType b)
+{
+    return std::abs(a-b) < 1e-10;
+}
+
+int main(int argc, char* argv[])
+{
+    boost::mpi::environment env(argc,argv);
+
+    srand(1);
+
+    TermList<NRTerm> NRTree(NRTerm::Compare(1e-8), NRTerm::IsNegligible(1e-16));
+    TermList<NRTerm> NRFlat(NRTerm::Compare(1e-8), NRTerm::IsNegligible(1e-16), FlatStorage);
+    TermList<RTerm> RTree(RTerm::Compare(1e-8), RTerm::IsNegligible(1e-16));
+    TermList<RTerm> RFlat(RTerm::Compare(1e-8), RTerm::IsNegligible(1e-16));
+    RFlat.set_storage(FlatStorage);
+
+    // Enough terms to trigger intermediate reductions of the flat buffers
+    for(int n = 0; n < 200000; ++n){
+        NRTerm nr(random_coeff(), random_pole(), random_pole(), random_pole(), rand() % 2);
+        NRTree.add_term(nr);
+        NRFlat.add_term(nr);
+        RTerm r(random_coeff(), random_coeff(), random_pole(), random_pole(), random_pole(), rand() % 2);
+        RTree.add_term(r);
+        RFlat.add_term(r);
+    }
+    NRFlat.reduce();
+    RFlat.reduce();
+
+    INFO("Non-resonant terms: " << NRTree.size() << " (tree), " << NRFlat.size() << " (flat)");
+    INFO("Resonant terms: " << RTree.size() << " (tree), " << RFlat.size() << " (flat)");
+
+    if(NRTree.size() != NRFlat.size() || RTree.size() != RFlat.size()) return EXIT_FAILURE;
+    if(!NRFlat.check_terms() || !RFlat.check_terms()) return EXIT_FAILURE;
+
+    for(int n = 0; n < 10; ++n){
+        ComplexType z1(0.1*n, 0.3), z2(-0.2, 0.5*n+0.1), z3(0.05*n, -0.7);
+        if(!compare(NRTree(z1,z2,z3), NRFlat(z1,z2,z3))) return EXIT_FAILURE;
+        if(!compare(RTree(z1,z2,z3,1e-8), RFlat(z1,z2,z3,1e-8))) return EXIT_FAILURE;
+    }
+
+    // Switching back to the tree layout must preserve the terms
+    NRFlat.set_storage(TreeStorage);
+    if(NRFlat.size() != NRTree.size() || !NRFlat.check_terms()) return EXIT_FAILURE;
+
+    // Terms near the tolerance: only sums of like terms are neglected, with the
+    // tolerance divided by the number of terms, wherever they are in the list
+    TermList<NRTerm> SmallTree(NRTerm::Compare(1e-8), NRTerm::IsNegligible(1e-6));
+    TermList<NRTerm> SmallFlat(NRTerm::Compare(1e-8), NRTerm::IsNegligible(1e-6), FlatStorage);
+    for(int n = 0; n < 8; ++n){
+        RealType P = 0.25*n;
+        // A single small term is never neglected
+        NRTerm single(1e-9, P, 0.1, 0.1, false);
+        SmallTree.add_term(single); SmallFlat.add_term(single);
+        // Cancelling terms are neglected
+        NRTerm c1(0.5, P, 0.2, 0.2, false), c2(-0.5+1e-12, P, 0.2, 0.2, false);
+        SmallTree.add_term(c1); SmallFlat.add_term(c1);
+        SmallTree.add_term(c2); SmallFlat.add_term(c2);
+    }
+    // A sum below the tolerance, but above the tolerance divided by the number of terms,
+    // is kept, including the ones at the beginning of the list
+    for(int n = 0; n < 8; ++n){
+        RealType P = -1.0 - 0.25*n;
+        NRTerm k1(0.25, P, 0.3, 0.3, false), k2(-0.25+3e-7, P, 0.3, 0.3, false);
+        SmallTree.add_term(k1); SmallFlat.add_term(k1);
+        SmallTree.add_term(k2); SmallFlat.add_term(k2);
+    }
+    SmallFlat.reduce();
+
+    INFO("Small terms: " << SmallTree.size() << " (tree), " << SmallFlat.size() << " (flat)");
+    if(SmallTree.size() != 16 || SmallFlat.size() != 16) return EXIT_FAILURE;
+    for(int n = 0; n < 10; ++n){
+        ComplexType z1(0.1*n, 0.3), z2(-0.2, 0.5*n+0.1), z3(0.05*n, -0.7);
+        if(!compare(SmallTree(z1,z2,z3), SmallFlat(z1,z2,z3))) return EXIT_FAILURE;
+    }
+
+    INFO("SUCCESS");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,237 @@
+//
+// This file is a part of pomerol - a scientific ED code for obtaining
+// properties of a Hubbard model on a finite-size lattice
+//
+// Copyright (C) 2010-2012 Andrey Antipov <antipov@ct-qmc.org>
+// Copyright (C) 2010-2012 Igor Krivenko <igor@shg.ru>
+//
+// pomerol is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// pomerol is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with pomerol.  If not, see <http://www.gnu.org/licenses/>.
+
+/** \file tests/TwoParticleGFTest.cpp
+** \brief Test of the evaluation paths of a two-particle Green's function (2 sites).
+*/
+
+#include "Misc.h"
+#include "Lattice.h"
+#include "LatticePresets.h"
+#include "Index.h"
+#include "IndexClassification.h"
+#include "Operator.h"
+#include "OperatorPresets.h"
+#include "IndexHamiltonian.h"
+#include "Symmetrizer.h"
+#include "StatesClassification.h"
+#include "HamiltonianPart.h"
+#include "Hamiltonian.h"
+#include "FieldOperatorContainer.h"
+#include "TwoParticleGF.h"
+
+#include<cstdlib>
+
+using namespace Pomerol;
+
+typedef boost::tuple<ComplexType, ComplexType, ComplexType> freq_tuple;
+
+RealType U = 1.0;
+RealType mu = 0.4;
+RealType beta = 10.0;
+
+bool compare(ComplexType a, ComplexType b)
+{
+    return std::abs(a-b) < 1e-10*(1.0 + std::abs(b));
+}
+
+int main(int argc, char* argv[])
+{
+    boost::mpi::environment env(argc,argv);
+    boost::mpi::communicator world;
+
+    Lattice L;
+    L.addSite(new Lattice::Site("A",1,2));
+    LatticePresets::addCoulombS(&L, "A", U, -mu);
+    L.addSite(new Lattice::Site("B",1,2));
+    LatticePresets::addCoulombS(&L, "B", U, -mu);
+    LatticePresets::addHopping(&L, "A","B", -1.0);
+
+    IndexClassification IndexInfo(L.getSiteMap());
+    IndexInfo.prepare();
+
+    IndexHamiltonian Storage(&L,IndexInfo);
+    Storage.prepare();
+    Symmetrizer Symm(IndexInfo, Storage);
+    Symm.compute();
+
+    StatesClassification S(IndexInfo,Symm);
+    S.compute();
+
+    Hamiltonian H(IndexInfo, Storage, S);
+    H.prepare();
+    H.compute(world);
+
+    DensityMatrix rho(S,H,beta);
+    rho.prepare();
+    rho.compute();
+
+    FieldOperatorContainer Operators(IndexInfo, S, H);
+    Operators.prepareAll();
+    Operators.computeAll();
+
+    ParticleIndex u0 = IndexInfo.getIndex("A",0,up);
+    ParticleIndex d0 = IndexInfo.getIndex("A",0,down);
+    ParticleIndex u1 = IndexInfo.getIndex("B",0,up);
+
+    // Frequencies (W+w3, w2, w3) including the resonant points
+    int wn = 3;
+    FrequencyGrid Grid(-1, 1, -wn, wn-1);
+    std::vector<freq_tuple> freqs;
+    for(int W = -1; W <= 1; ++W)
+    for(int n3 = -wn; n3 < wn; ++n3)
+    for(int n2 = -wn; n2 < wn; ++n2){
+        ComplexType w3 = I*M_PI*RealType(2*n3+1)/beta;
+        ComplexType w2 = I*M_PI*RealType(2*n2+1)/beta;
+        ComplexType Omega = I*M_PI*RealType(2*W)/beta;
+        freqs.push_back(freq_tuple(Omega+w3, w2, w3));
+    }
+
+    FrequencyBlock GridFreqs(Grid, beta);
+    for(size_t w = 0; w < freqs.size(); ++w){
+        if(!compare(GridFreqs.z1(w), boost::get<0>(freqs[w])) ||
+           !compare(GridFreqs.z2(w), boost::get<1>(freqs[w])) ||
+           !compare(GridFreqs.z3(w), boost::get<2>(freqs[w]))) {
+            ERROR("Frequency grid mismatch at " << w);
+            return EXIT_FAILURE;
+        }
+    }
+
+    ParticleIndex Indices[2][4] = { {u0, u0, u0, u0}, {u0, d0, u1, d0} };
+    for(int c = 0; c < 2; ++c){
+        TwoParticleGF Chi(S,H,
+            Operators.getAnnihilationOperator(Indices[c][0]), Operators.getAnnihilationOperator(Indices[c][1]),
+            Operators.getCreationOperator(Indices[c][2]), Operators.getCreationOperator(Indices[c][3]), rho);
+        Chi.ReduceResonanceTolerance = 1e-8;
+        Chi.prepare();
+        Chi.compute(false, std::vector<freq_tuple>(), world);
+
+        std::vector<ComplexType> ref(freqs.size());
+        for(size_t w = 0; w < freqs.size(); ++w)
+            ref[w] = Chi(boost::get<0>(freqs[w]), boost::get<1>(freqs[w]), boost::get<2>(freqs[w]));
+
+        // Batched evaluation
+        std::vector<ComplexType> batch(freqs.size());
+        Chi.evaluate(FrequencyBlock(freqs), &batch[0]);
+        for(size_t w = 0; w < freqs.size(); ++w){
+            if(!compare(batch[w], ref[w])){
+                ERROR("Batched evaluation: " << batch[w] << " != " << ref[w]);
+                return EXIT_FAILURE;
+            }
+        }
+        INFO("Component " << c << ": batched evaluation OK");
+
+        // Factorized evaluation on a grid
+        std::vector<ComplexType> grid(Grid.size());
+        Chi.evaluate(Grid, &grid[0]);
+        for(size_t w = 0; w < freqs.size(); ++w){
+            if(!compare(grid[w], ref[w])){
+                ERROR("Grid evaluation: " << grid[w] << " != " << ref[w]);
+                return EXIT_FAILURE;
+            }
+        }
+        INFO("Component " << c << ": grid evaluation OK");
+
+        // Frozen terms
+        for(size_t p = 0; p < Chi.parts.size(); ++p) Chi.parts[p]->freeze();
+        for(size_t w = 0; w < freqs.size(); ++w){
+            ComplexType val = Chi(boost::get<0>(freqs[w]), boost::get<1>(freqs[w]), boost::get<2>(freqs[w]));
+            if(!compare(val, ref[w])){
+                ERROR("Frozen terms: " << val << " != " << ref[w]);
+                return EXIT_FAILURE;
+            }
+        }
+        INFO("Component " << c << ": frozen terms OK");
+
+        // Values filled during the computation
+        TwoParticleGF Chi2(S,H,
+            Operators.getAnnihilationOperator(Indices[c][0]), Operators.getAnnihilationOperator(Indices[c][1]),
+            Operators.getCreationOperator(Indices[c][2]), Operators.getCreationOperator(Indices[c][3]), rho);
+        Chi2.ReduceResonanceTolerance = 1e-8;
+        Chi2.prepare();
+        std::vector<ComplexType> filled = Chi2.compute(true, freqs, world);
+        // The values are reduced to the root process only
+        if(world.rank() == 0)
+        for(size_t w = 0; w < freqs.size(); ++w){
+            if(!compare(filled[w], ref[w])){
+                ERROR("Values filled in compute(): " << filled[w] << " != " << ref[w]);
+                return EXIT_FAILURE;
+            }
+        }
+        INFO("Component " << c << ": values filled in compute() OK");
+
+        TwoParticleGF Chi3(S,H,
+            Operators.getAnnihilationOperator(Indices[c][0]), Operators.getAnnihilationOperator(Indices[c][1]),
+            Operators.getCreationOperator(Indices[c][2]), Operators.getCreationOperator(Indices[c][3]), rho);
+        Chi3.ReduceResonanceTolerance = 1e-8;
+        Chi3.prepare();
+        std::vector<ComplexType> filled_grid = Chi3.compute(true, Grid, world);
+        if(world.rank() == 0)
+        for(size_t w = 0; w < freqs.size(); ++w){
+            if(!compare(filled_grid[w], ref[w])){
+                ERROR("Grid values filled in compute(): " << filled_grid[w] << " != " << ref[w]);
+                return EXIT_FAILURE;
+            }
+        }
+        INFO("Component " << c << ": grid values filled in compute() OK");
+
+        // Terms computed by multiple threads
+        for(int storage = 0; storage < 2; ++storage){
+            TwoParticleGF Chi4(S,H,
+                Operators.getAnnihilationOperator(Indices[c][0]), Operators.getAnnihilationOperator(Indices[c][1]),
+                Operators.getCreationOperator(Indices[c][2]), Operators.getCreationOperator(Indices[c][3]), rho);
+            Chi4.ReduceResonanceTolerance = 1e-8;
+            Chi4.TermsStorage = storage ? FlatStorage : TreeStorage;
+            Chi4.ThreadedCompute = true;
+            Chi4.prepare();
+            Chi4.compute(false, std::vector<freq_tuple>(), world);
+            for(size_t w = 0; w < freqs.size(); ++w){
+                ComplexType val = Chi4(boost::get<0>(freqs[w]), boost::get<1>(freqs[w]), boost::get<2>(freqs[w]));
+                if(!compare(val, ref[w])){
+                    ERROR("Threaded compute: " << val << " != " << ref[w]);
+                    return EXIT_FAILURE;
+                }
+            }
+        }
+        INFO("Component " << c << ": threaded compute OK");
+
+        // Terms kept by the processes, which have computed them
+        TwoParticleGF Chi5(S,H,
+            Operators.getAnnihilationOperator(Indices[c][0]), Operators.getAnnihilationOperator(Indices[c][1]),
+            Operators.getCreationOperator(Indices[c][2]), Operators.getCreationOperator(Indices[c][3]), rho);
+        Chi5.ReduceResonanceTolerance = 1e-8;
+        Chi5.DistributedTerms = true;
+        Chi5.prepare();
+        Chi5.compute(false, std::vector<freq_tuple>(), world);
+        std::vector<ComplexType> distributed(freqs.size()), distributed_grid(Grid.size());
+        Chi5.evaluate(FrequencyBlock(freqs), &distributed[0], world);
+        Chi5.evaluate(Grid, &distributed_grid[0], world);
+        for(size_t w = 0; w < freqs.size(); ++w){
+            if(!compare(distributed[w], ref[w]) || !compare(distributed_grid[w], ref[w])){
+                ERROR("Distributed terms: " << distributed[w] << ", " << distributed_grid[w] << " != " << ref[w]);
+                return EXIT_FAILURE;
+            }
+        }
+        INFO("Component " << c << ": distributed terms OK");
+    }
+
+    INFO("SUCCESS");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,71 @@
+#include <mpi_dispatcher/mpi_dispatcher.hpp>
+#include <thread>
+#include <random>
+#include <iostream>
+
+using namespace pMPI;
+
+int dumb_task_counter;
+
+void dumb_task(double seconds, int jobid, int rank) {
+    std::cout << "[" << rank << "] running job " << jobid << " " << seconds << " seconds..." << std::flush;
+    std::this_thread::sleep_for(std::chrono::milliseconds(int(seconds * 1000)));
+    ++dumb_task_counter;
+    std::cout << "done." << std::endl;
+};
+
+int main(int argc, char *argv[]) {
+
+    MPI_Init(&argc, &argv);
+
+    boost::mpi::communicator world;
+    std::mt19937 gen(100000);
+    std::uniform_real_distribution<double> dist(0, 0.01);
+    int rank = world.rank();
+
+    try {
+        int ntasks = 45;
+        dumb_task_counter = 0;
+
+        // Make the first process much slower, so that its jobs get stolen
+        std::vector<JobId> task_numbers(ntasks);
+        for (int i=0; i<ntasks; i++) task_numbers[i] = i;
+
+        MPIStealingWorker worker(world, task_numbers);
+        while (worker.next_job()) {
+            dumb_task(dist(gen) * (rank == 0 ? 10 : 1), worker.current_job(), rank);
+            worker.report_job_done();
+        };
+
+        std::map<JobId, WorkerId> job_map = worker.dispatch_map();
+        if (job_map.size() != size_t(ntasks)) {
+            std::cout << "ntasks = " << ntasks << ", dispatched jobs = " << job_map.size() << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        // The slow process must have given some of its cyclic share of jobs away
+        if (rank == 0 && world.size() > 1) {
+            int share = (ntasks + world.size() - 1) / world.size();
+            if (int(worker.DoneJobs.size()) >= share) {
+                std::cout << "No jobs were stolen from the slow process: it ran " << worker.DoneJobs.size()
+                          << " jobs of its share of " << share << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+
+        MPI_Allreduce(MPI_IN_PLACE, &dumb_task_counter, 1, MPI_INT, MPI_SUM, world);
+        if(dumb_task_counter != ntasks) {
+            std::cout << "ntasks = " << ntasks
+                      << ", dumb_task_counter = "
+                      << dumb_task_counter << std::endl;
+            return EXIT_FAILURE;
+        }
+    } // end try
+    catch (std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    };
+
+    MPI_Finalize();
+    return EXIT_SUCCESS;
+}